@@ -0,0 +1,587 @@
+﻿/****************************************************************************
+ Copyright (c) 2016-2020 Jeff Wang <summer_insects@163.com>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ ****************************************************************************/
+
+#include "cache.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define CACHE_SHARD_CNT 16  // 分片数，各片分别加锁
+#define CACHE_ENTRY_OVERHEAD 64  // 每个条目在链表与哈希表中的额外开销，估算值
+
+namespace mahjong {
+
+// 64位混合函数（splitmix64）
+static FORCE_INLINE uint64_t mix_hash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+namespace {
+
+    // 缓存的种类，不同函数的结果互不混用
+    enum cache_kind_t {
+        CACHE_KIND_BASIC_FORM_SHANTEN = 1,
+        CACHE_KIND_BASIC_FORM_SHANTEN_USEFUL,
+        CACHE_KIND_WAITING,
+        CACHE_KIND_DISCARDS,
+        CACHE_KIND_FAN
+    };
+
+    // 手牌的键
+    // 完整记录影响结果的全部输入，哈希值相同时以此判断是否为同一局面，不会因哈希冲突取错结果
+    struct hand_key_t {
+        tile_counts_t counts;  // 立牌中各种牌的张数
+        uint64_t packs;      // 副露，每组16位
+        uint64_t extra;      // 低8位为种类，其余为各函数的其他参数
+
+        bool operator==(const hand_key_t &other) const {
+            return counts.words[0] == other.counts.words[0] && counts.words[1] == other.counts.words[1]
+                && packs == other.packs && extra == other.extra;
+        }
+    };
+
+    // 手牌的64位哈希值
+    struct hand_key_hash_t {
+        size_t operator()(const hand_key_t &key) const {
+            uint64_t h = mix_hash(key.counts.words[0]);
+            h = mix_hash(h ^ key.counts.words[1]);
+            h = mix_hash(h ^ key.packs);
+            h = mix_hash(h ^ key.extra);
+            return static_cast<size_t>(h);
+        }
+    };
+
+    // 缓存条目
+    struct cache_entry_t {
+        hand_key_t key;
+        std::vector<uint8_t> value;
+    };
+
+    typedef std::list<cache_entry_t> cache_list_t;
+
+    // 缓存的一片
+    struct cache_shard_t {
+        std::mutex mutex;
+        cache_list_t lru;  // 最近使用的在前
+        std::unordered_map<hand_key_t, cache_list_t::iterator, hand_key_hash_t> index;
+        size_t memory_size = 0;
+        uint64_t hit_count = 0;
+        uint64_t miss_count = 0;
+        uint64_t eviction_count = 0;
+    };
+}
+
+static cache_shard_t cache_shards[CACHE_SHARD_CNT];
+static std::atomic<size_t> cache_capacity(CACHE_DEFAULT_CAPACITY);
+
+// 条目估算占用的内存
+static FORCE_INLINE size_t entry_memory_size(size_t value_size) {
+    return sizeof(cache_entry_t) + value_size + CACHE_ENTRY_OVERHEAD;
+}
+
+// 键所在的分片，用哈希值的高位，低位已用于哈希表的桶
+static FORCE_INLINE cache_shard_t &get_shard(const hand_key_t &key) {
+    uint64_t h = static_cast<uint64_t>(hand_key_hash_t()(key));
+    return cache_shards[(h >> 32) % CACHE_SHARD_CNT];
+}
+
+// 淘汰最近最少使用的条目，直到不超过一片的内存上限
+static void shard_evict(cache_shard_t &shard, size_t shard_capacity) {
+    while (shard.memory_size > shard_capacity && !shard.lru.empty()) {
+        const cache_entry_t &entry = shard.lru.back();
+        shard.memory_size -= entry_memory_size(entry.value.size());
+        shard.index.erase(entry.key);
+        shard.lru.pop_back();
+        ++shard.eviction_count;
+    }
+}
+
+// 查找缓存，命中时将结果复制到value，并返回结果的大小；未命中返回0
+static size_t cache_lookup(const hand_key_t &key, void *value, size_t max_size) {
+    cache_shard_t &shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end() || it->second->value.size() > max_size) {
+        ++shard.miss_count;
+        return 0;
+    }
+
+    ++shard.hit_count;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);  // 移到最前
+    const std::vector<uint8_t> &cached = it->second->value;
+    memcpy(value, cached.data(), cached.size());
+    return cached.size();
+}
+
+// 存入缓存
+static void cache_store(const hand_key_t &key, const void *value, size_t size) {
+    size_t shard_capacity = cache_capacity.load(std::memory_order_relaxed) / CACHE_SHARD_CNT;
+    if (entry_memory_size(size) > shard_capacity) {
+        return;
+    }
+
+    cache_shard_t &shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {  // 其他线程已经存过了
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.push_front(cache_entry_t{ key, std::vector<uint8_t>(bytes, bytes + size) });
+    shard.index.emplace(key, shard.lru.begin());
+    shard.memory_size += entry_memory_size(size);
+    shard_evict(shard, shard_capacity);
+}
+
+// 是否启用了缓存
+static FORCE_INLINE bool is_cache_enabled() {
+    return cache_capacity.load(std::memory_order_relaxed) != 0;
+}
+
+// 将立牌的张数写入键，有不合法的牌或者某种牌超过4张时返回false，此时不使用缓存
+static bool make_counts_key(const tile_t *tiles, intptr_t cnt, hand_key_t *key) {
+    key->counts.words[0] = 0;
+    key->counts.words[1] = 0;
+    if (tiles == nullptr || cnt < 0 || cnt > 14) {
+        return false;
+    }
+
+    for (intptr_t i = 0; i < cnt; ++i) {
+        if (!is_tile_countable(tiles[i]) || tile_counts_get(key->counts, tiles[i]) == 4) {
+            return false;
+        }
+        tile_counts_add(&key->counts, tiles[i]);
+    }
+    return true;
+}
+
+// 将手牌写入键，副露超过4组时返回false
+static bool make_hand_key(const hand_tiles_t *hand_tiles, hand_key_t *key) {
+    if (hand_tiles->pack_count < 0 || hand_tiles->pack_count > 4) {
+        return false;
+    }
+    if (!make_counts_key(hand_tiles->standing_tiles, hand_tiles->tile_count, key)) {
+        return false;
+    }
+    key->packs = 0;
+    for (intptr_t i = 0; i < hand_tiles->pack_count; ++i) {
+        key->packs |= static_cast<uint64_t>(hand_tiles->fixed_packs[i]) << (i * 16);
+    }
+    return true;
+}
+
+// 数牌的花色下标，万、条、饼依次为0、1、2；字牌或不合法的牌返回-1
+static FORCE_INLINE int numbered_suit_index(tile_t tile) {
+    suit_t suit = tile_get_suit(tile);
+    rank_t rank = tile_get_rank(tile);
+    return (suit >= TILE_SUIT_CHARACTERS && suit <= TILE_SUIT_DOTS && rank >= 1 && rank <= 9) ? suit - TILE_SUIT_CHARACTERS : -1;
+}
+
+// 按花色下标的映射置换一张牌，字牌及不合法的牌不变
+static FORCE_INLINE tile_t permute_tile(const uint8_t (&suit_map)[3], tile_t tile) {
+    int idx = numbered_suit_index(tile);
+    return idx < 0 ? tile : make_tile(static_cast<suit_t>(TILE_SUIT_CHARACTERS + suit_map[idx]), tile_get_rank(tile));
+}
+
+// 是否为恒等置换
+static FORCE_INLINE bool is_identity_permutation(const suit_permutation_t &permutation) {
+    return permutation.to_canonical[0] == 0 && permutation.to_canonical[1] == 1;
+}
+
+// 绿一色与推不倒构成牌的点数掩码，第n位表示点数n
+#define GREEN_RANK_MASK         0x15CU  // 23468
+#define REVERSIBLE_BAMBOO_MASK  0x374U  // 245689
+#define REVERSIBLE_DOTS_MASK    0x33EU  // 1234589
+#define GREEN_HONOR_MASK        (1U << 6)  // 发
+#define REVERSIBLE_HONOR_MASK   (1U << 7)  // 白
+
+// 记录一张牌的点数，masks下标为花色减1
+static FORCE_INLINE void add_rank_mask(tile_t tile, uint16_t (&masks)[4]) {
+    suit_t suit = tile_get_suit(tile);
+    if (suit >= TILE_SUIT_CHARACTERS && suit <= TILE_SUIT_HONORS) {
+        masks[suit - TILE_SUIT_CHARACTERS] |= static_cast<uint16_t>(1U << tile_get_rank(tile));
+    }
+}
+
+bool is_suit_permutation_safe(suit_query_t query, const hand_tiles_t *hand_tiles, tile_t extra_tile) {
+    // 上听数、听牌、打牌对三门数牌是对称的
+    if (query != SUIT_QUERY_FAN) {
+        return true;
+    }
+
+    // 各门花色出现的点数
+    uint16_t masks[4] = { 0 };
+    for (intptr_t i = 0; i < hand_tiles->tile_count; ++i) {
+        add_rank_mask(hand_tiles->standing_tiles[i], masks);
+    }
+    for (intptr_t i = 0; i < hand_tiles->pack_count; ++i) {
+        pack_t pack = hand_tiles->fixed_packs[i];
+        tile_t tile = pack_get_tile(pack);
+        add_rank_mask(tile, masks);
+        if (pack_get_type(pack) == PACK_TYPE_CHOW) {
+            add_rank_mask(static_cast<tile_t>(tile - 1), masks);
+            add_rank_mask(static_cast<tile_t>(tile + 1), masks);
+        }
+    }
+    if (extra_tile != 0) {
+        add_rank_mask(extra_tile, masks);
+    }
+
+    // 绿一色只用条子，推不倒只用条子与饼子，其余番种对三门数牌都是对称的
+    // 某种花色分配下可能构成这两个番种时，置换会改变结果
+    int suit_cnt = (masks[0] != 0) + (masks[1] != 0) + (masks[2] != 0);
+    uint16_t numbered_mask = masks[0] | masks[1] | masks[2];
+
+    // 绿一色：只有一门数牌且都是23468，字牌只有发
+    if (suit_cnt <= 1 && (numbered_mask & ~GREEN_RANK_MASK) == 0 && (masks[3] & ~GREEN_HONOR_MASK) == 0) {
+        return false;
+    }
+
+    // 推不倒：至多两门数牌，分别作为条子和饼子时都是推不倒构成牌，字牌只有白
+    if (suit_cnt <= 2 && (masks[3] & ~REVERSIBLE_HONOR_MASK) == 0) {
+        for (int b = 0; b < 3; ++b) {
+            for (int p = 0; p < 3; ++p) {
+                if (b == p || masks[3 - b - p] != 0) {
+                    continue;
+                }
+                if ((masks[b] & ~REVERSIBLE_BAMBOO_MASK) == 0 && (masks[p] & ~REVERSIBLE_DOTS_MASK) == 0) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void canonicalize_suits(const hand_tiles_t *hand_tiles, tile_t extra_tile,
+    hand_tiles_t *canonical_hand, tile_t *canonical_extra, suit_permutation_t *permutation) {
+    // 各门数牌的排序键：高位为立牌中每种点数的张数，点数小的在高位；
+    // 低位为副露与上牌，只在立牌相同的花色之间决定先后
+    uint64_t sort_keys[3] = { 0, 0, 0 };
+    for (intptr_t i = 0; i < hand_tiles->tile_count; ++i) {
+        tile_t tile = hand_tiles->standing_tiles[i];
+        int idx = numbered_suit_index(tile);
+        if (idx >= 0) {
+            sort_keys[idx] += 1ULL << (32 + (9 - tile_get_rank(tile)) * 3);
+        }
+    }
+    for (intptr_t i = 0; i < hand_tiles->pack_count; ++i) {
+        tile_t tile = pack_get_tile(hand_tiles->fixed_packs[i]);
+        int idx = numbered_suit_index(tile);
+        if (idx >= 0) {
+            sort_keys[idx] += 1ULL << (5 + (9 - tile_get_rank(tile)) * 3);
+        }
+    }
+    int extra_idx = numbered_suit_index(extra_tile);
+    if (extra_idx >= 0) {
+        sort_keys[extra_idx] += tile_get_rank(extra_tile);
+    }
+
+    // 按排序键从大到小，相同时保持原来的顺序
+    uint8_t order[3] = { 0, 1, 2 };
+    for (int i = 1; i < 3; ++i) {
+        for (int j = i; j > 0 && sort_keys[order[j - 1]] < sort_keys[order[j]]; --j) {
+            std::swap(order[j - 1], order[j]);
+        }
+    }
+    for (uint8_t i = 0; i < 3; ++i) {
+        permutation->from_canonical[i] = order[i];
+        permutation->to_canonical[order[i]] = i;
+    }
+
+    canonical_hand->tile_count = hand_tiles->tile_count;
+    canonical_hand->pack_count = hand_tiles->pack_count;
+    for (intptr_t i = 0; i < hand_tiles->tile_count; ++i) {
+        canonical_hand->standing_tiles[i] = permute_tile(permutation->to_canonical, hand_tiles->standing_tiles[i]);
+    }
+    for (intptr_t i = 0; i < hand_tiles->pack_count; ++i) {
+        pack_t pack = hand_tiles->fixed_packs[i];
+        canonical_hand->fixed_packs[i] = make_pack(pack_get_offer(pack), pack_get_type(pack),
+            permute_tile(permutation->to_canonical, pack_get_tile(pack)));
+    }
+    *canonical_extra = permute_tile(permutation->to_canonical, extra_tile);
+}
+
+tile_t restore_suit_tile(const suit_permutation_t *permutation, tile_t tile) {
+    return permute_tile(permutation->from_canonical, tile);
+}
+
+void restore_suit_useful_table(const suit_permutation_t *permutation, useful_table_t *useful_table) {
+    if (is_identity_permutation(*permutation)) {
+        return;
+    }
+
+    // 原来的牌是否有效，等于置换后的牌在规范形式中是否有效
+    useful_table_t canonical_table;
+    memcpy(canonical_table, *useful_table, sizeof(canonical_table));
+    for (int i = 0; i < 3; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        suit_t canonical_suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + permutation->to_canonical[i]);
+        for (rank_t rank = 1; rank <= 9; ++rank) {
+            (*useful_table)[make_tile(suit, rank)] = canonical_table[make_tile(canonical_suit, rank)];
+        }
+    }
+}
+
+// 手牌的张数与副露组数在数组范围内，才能置换
+static FORCE_INLINE bool is_hand_size_valid(const hand_tiles_t *hand_tiles) {
+    return hand_tiles->tile_count >= 0 && hand_tiles->tile_count <= 13
+        && hand_tiles->pack_count >= 0 && hand_tiles->pack_count <= 4;
+}
+
+void cache_set_capacity(size_t capacity) {
+    cache_capacity.store(capacity, std::memory_order_relaxed);
+    for (cache_shard_t &shard : cache_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard_evict(shard, capacity / CACHE_SHARD_CNT);
+    }
+}
+
+void cache_clear() {
+    for (cache_shard_t &shard : cache_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.memory_size = 0;
+    }
+}
+
+void cache_get_stats(cache_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (cache_shard_t &shard : cache_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats->hit_count += shard.hit_count;
+        stats->miss_count += shard.miss_count;
+        stats->eviction_count += shard.eviction_count;
+        stats->entry_count += shard.lru.size();
+        stats->memory_size += shard.memory_size;
+    }
+}
+
+void cache_reset_stats() {
+    for (cache_shard_t &shard : cache_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.hit_count = 0;
+        shard.miss_count = 0;
+        shard.eviction_count = 0;
+    }
+}
+
+namespace {
+
+    // 上听数的缓存值
+    struct shanten_value_t {
+        int shanten;
+        useful_table_t useful_table;
+    };
+
+    // 听牌的缓存值
+    struct waiting_value_t {
+        bool waiting;
+        useful_table_t waiting_table;
+    };
+
+    // 算番的缓存值
+    struct fan_value_t {
+        int fan;
+        fan_table_t fan_table;
+    };
+}
+
+int cached_basic_form_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table) {
+    if (!is_cache_enabled() || standing_tiles == nullptr
+        || (standing_cnt != 13 && standing_cnt != 10 && standing_cnt != 7 && standing_cnt != 4 && standing_cnt != 1)) {
+        return basic_form_shanten(standing_tiles, standing_cnt, useful_table);
+    }
+
+    // 置换为规范形式，花色互换的立牌共用一个条目
+    hand_tiles_t hand_tiles, canonical_hand;
+    memcpy(hand_tiles.standing_tiles, standing_tiles, standing_cnt * sizeof(tile_t));
+    hand_tiles.tile_count = standing_cnt;
+    hand_tiles.pack_count = 0;
+    tile_t canonical_extra;
+    suit_permutation_t permutation;
+    canonicalize_suits(&hand_tiles, 0, &canonical_hand, &canonical_extra, &permutation);
+
+    hand_key_t key;
+    if (!make_counts_key(canonical_hand.standing_tiles, standing_cnt, &key)) {
+        return basic_form_shanten(standing_tiles, standing_cnt, useful_table);
+    }
+    key.packs = 0;
+    key.extra = (useful_table != nullptr) ? CACHE_KIND_BASIC_FORM_SHANTEN_USEFUL : CACHE_KIND_BASIC_FORM_SHANTEN;
+
+    // 不需要有效牌时只缓存上听数
+    shanten_value_t value;
+    size_t value_size = (useful_table != nullptr) ? sizeof(value) : sizeof(value.shanten);
+    if (cache_lookup(key, &value, value_size) == 0) {
+        value.shanten = basic_form_shanten(canonical_hand.standing_tiles, standing_cnt, useful_table != nullptr ? &value.useful_table : nullptr);
+        cache_store(key, &value, value_size);
+    }
+
+    if (useful_table != nullptr) {
+        memcpy(*useful_table, value.useful_table, sizeof(*useful_table));
+        restore_suit_useful_table(&permutation, useful_table);
+    }
+    return value.shanten;
+}
+
+bool cached_is_waiting(const hand_tiles_t &hand_tiles, useful_table_t *useful_table) {
+    if (!is_cache_enabled() || !is_hand_size_valid(&hand_tiles)) {
+        return is_waiting(hand_tiles, useful_table);
+    }
+
+    hand_tiles_t canonical_hand;
+    tile_t canonical_extra;
+    suit_permutation_t permutation;
+    canonicalize_suits(&hand_tiles, 0, &canonical_hand, &canonical_extra, &permutation);
+
+    hand_key_t key;
+    if (!make_hand_key(&canonical_hand, &key)) {
+        return is_waiting(hand_tiles, useful_table);
+    }
+    // 听牌只与立牌有关
+    key.packs = 0;
+    key.extra = CACHE_KIND_WAITING;
+
+    waiting_value_t value;
+    if (cache_lookup(key, &value, sizeof(value)) == 0) {
+        value.waiting = is_waiting(canonical_hand, &value.waiting_table);
+        cache_store(key, &value, sizeof(value));
+    }
+
+    if (useful_table != nullptr) {
+        memcpy(*useful_table, value.waiting_table, sizeof(*useful_table));
+        restore_suit_useful_table(&permutation, useful_table);
+    }
+    return value.waiting;
+}
+
+intptr_t cached_evaluate_all_discards(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag, enum_result_t *results) {
+    if (!is_cache_enabled() || !is_hand_size_valid(hand_tiles)) {
+        return evaluate_all_discards(hand_tiles, serving_tile, form_flag, results);
+    }
+
+    hand_tiles_t canonical_hand;
+    tile_t canonical_serving;
+    suit_permutation_t permutation;
+    canonicalize_suits(hand_tiles, serving_tile, &canonical_hand, &canonical_serving, &permutation);
+
+    hand_key_t key;
+    if (!make_hand_key(&canonical_hand, &key)) {
+        return evaluate_all_discards(hand_tiles, serving_tile, form_flag, results);
+    }
+    // 打牌只与立牌有关，副露组数由立牌数决定
+    key.packs = 0;
+    key.extra = CACHE_KIND_DISCARDS | (static_cast<uint64_t>(canonical_serving) << 8) | (static_cast<uint64_t>(form_flag) << 16);
+
+    // 以结果的个数为首，之后是结果
+    struct {
+        intptr_t cnt;
+        enum_result_t results[MAX_DISCARD_RESULT_CNT];
+    } value;
+    if (cache_lookup(key, &value, sizeof(value)) == 0) {
+        value.cnt = evaluate_all_discards(&canonical_hand, canonical_serving, form_flag, value.results);
+        cache_store(key, &value, offsetof(decltype(value), results) + value.cnt * sizeof(enum_result_t));
+    }
+
+    memcpy(results, value.results, value.cnt * sizeof(enum_result_t));
+    if (is_identity_permutation(permutation)) {
+        return value.cnt;
+    }
+
+    // 还原花色，并恢复evaluate_all_discards的顺序：先摸切，其余按牌的顺序
+    for (intptr_t i = 0; i < value.cnt; ++i) {
+        results[i].discard_tile = restore_suit_tile(&permutation, results[i].discard_tile);
+        restore_suit_useful_table(&permutation, &results[i].useful_table);
+    }
+    std::stable_sort(results, results + value.cnt, [serving_tile](const enum_result_t &a, const enum_result_t &b) {
+        int ia = (a.discard_tile == serving_tile) ? -1 : tile_get_index(a.discard_tile);
+        int ib = (b.discard_tile == serving_tile) ? -1 : tile_get_index(b.discard_tile);
+        return ia < ib;
+    });
+    return value.cnt;
+}
+
+void cached_enum_discard_tile(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag,
+    void *context, enum_callback_t enum_callback) {
+    enum_result_t results[MAX_DISCARD_RESULT_CNT];
+    intptr_t cnt = cached_evaluate_all_discards(hand_tiles, serving_tile, form_flag, results);
+    for (intptr_t i = 0; i < cnt; ++i) {
+        if (!enum_callback(context, &results[i])) {
+            return;
+        }
+    }
+}
+
+int cached_calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_table) {
+    if (!is_cache_enabled() || !is_hand_size_valid(&calculate_param->hand_tiles)) {
+        return calculate_fan(calculate_param, fan_table);
+    }
+
+    // 番表与花色无关，不需要还原；可能构成绿一色或推不倒时不置换
+    calculate_param_t canonical_param = *calculate_param;
+    if (is_suit_permutation_safe(SUIT_QUERY_FAN, &calculate_param->hand_tiles, calculate_param->win_tile)) {
+        suit_permutation_t permutation;
+        canonicalize_suits(&calculate_param->hand_tiles, calculate_param->win_tile,
+            &canonical_param.hand_tiles, &canonical_param.win_tile, &permutation);
+    }
+
+    hand_key_t key;
+    if (!make_hand_key(&canonical_param.hand_tiles, &key)) {
+        return calculate_fan(calculate_param, fan_table);
+    }
+    key.extra = CACHE_KIND_FAN
+        | (static_cast<uint64_t>(canonical_param.hand_tiles.pack_count) << 8)
+        | (static_cast<uint64_t>(canonical_param.win_tile) << 16)
+        | (static_cast<uint64_t>(canonical_param.flower_count) << 24)
+        | (static_cast<uint64_t>(canonical_param.win_flag) << 32)
+        | (static_cast<uint64_t>(canonical_param.prevalent_wind) << 40)
+        | (static_cast<uint64_t>(canonical_param.seat_wind) << 48);
+
+    fan_value_t value;
+    if (cache_lookup(key, &value, sizeof(value)) == 0) {
+        memset(value.fan_table, 0, sizeof(value.fan_table));
+        value.fan = calculate_fan(&canonical_param, &value.fan_table);
+        cache_store(key, &value, sizeof(value));
+    }
+
+    // 出错时不修改番表，与calculate_fan一致
+    if (fan_table != nullptr && value.fan >= 0) {
+        memcpy(*fan_table, value.fan_table, sizeof(*fan_table));
+    }
+    return value.fan;
+}
+
+}
@@ -102,6 +102,38 @@ bool map_hand_tiles(const hand_tiles_t *hand_tiles, tile_table_t *cnt_table) {
     return true;
 }
 
+// 将牌记入紧凑的计数
+bool map_tile_counts(const tile_t *tiles, intptr_t cnt, tile_counts_t *counts) {
+    counts->words[0] = 0;
+    counts->words[1] = 0;
+    for (intptr_t i = 0; i < cnt; ++i) {
+        tile_t t = tiles[i];
+        if (!is_tile_countable(t)) {  // 与牌表一致，不合法的牌不参与按花色的计算
+            continue;
+        }
+        if (tile_counts_get(*counts, t) == 7) {  // 再加就进位了
+            return false;
+        }
+        tile_counts_add(counts, t);
+    }
+    return true;
+}
+
+// 将牌表转换成紧凑的计数
+bool table_to_tile_counts(const tile_table_t &cnt_table, tile_counts_t *counts) {
+    counts->words[0] = 0;
+    counts->words[1] = 0;
+    for (int i = 0; i < 34; ++i) {
+        tile_t t = all_tiles[i];
+        if (cnt_table[t] > 7) {
+            return false;
+        }
+        int pos = tile_counts_position(t);
+        counts->words[pos >> 6] |= static_cast<uint64_t>(cnt_table[t]) << (pos & 63);
+    }
+    return true;
+}
+
 // 将表转换成牌
 intptr_t table_to_tiles(const tile_table_t &cnt_table, tile_t *tiles, intptr_t max_cnt) {
     intptr_t cnt = 0;
@@ -118,305 +150,414 @@ intptr_t table_to_tiles(const tile_table_t &cnt_table, tile_t *tiles, intptr_t m
     return cnt;
 }
 
+// 有效牌标记表转换成牌集合
+tile_set_t useful_table_to_tile_set(const useful_table_t &useful_table) {
+    tile_set_t set = 0;
+    for (int i = 0; i < 34; ++i) {
+        if (useful_table[all_tiles[i]]) {
+            set |= 1ULL << i;
+        }
+    }
+    return set;
+}
+
+// 牌集合转换成有效牌标记表
+void tile_set_to_useful_table(tile_set_t set, useful_table_t *useful_table) {
+    memset(*useful_table, 0, sizeof(*useful_table));
+    for (; set != 0; set &= set - 1) {
+        (*useful_table)[tile_set_first(set)] = true;
+    }
+}
+
 namespace {
 
-    // 路径单元，单元有面子、雀头、搭子等种类，见下面的宏
-    // 高8位表示类型，低8位表示牌
-    // 对于顺子和顺子搭子，牌指的是最小的一张牌，
-    // 例如在顺子123万中，牌为1万，在两面搭子45条中，牌为4条等等
-    typedef uint16_t path_unit_t;
-
-#define UNIT_TYPE_CHOW 1                // 顺子
-#define UNIT_TYPE_PUNG 2                // 刻子
-#define UNIT_TYPE_PAIR 4                // 雀头
-#define UNIT_TYPE_CHOW_OPEN_END 5       // 两面或者边张搭子
-#define UNIT_TYPE_CHOW_CLOSED 6         // 嵌张搭子
-#define UNIT_TYPE_INCOMPLETE_PUNG 7     // 刻子搭子
-
-#define MAKE_UNIT(type_, tile_) static_cast<path_unit_t>(((type_) << 8) | (tile_))
-#define UNIT_TYPE(unit_) (((unit_) >> 8) & 0xFF)
-#define UNIT_TILE(unit_) ((unit_) & 0xFF)
-
-#define MAX_STATE 512
-#define UNIT_SIZE 7
-
-    // 一条路径
-    struct work_path_t {
-        path_unit_t units[UNIT_SIZE];  // 14/2=7最多7个搭子
-        uint16_t depth;  // 当前路径深度
+    // 单门花色的牌型编码（下称花色键）
+    // 按5进制记录各点数的张数，1点在最低位，例如123m的花色键为1+5+25=31
+    typedef uint32_t suit_key_t;
+
+#define SUIT_KEY_NUMBERED_SIZE 1953125  // 数牌9种点数，5^9
+#define SUIT_KEY_HONORS_SIZE 78125      // 字牌7种，5^7
+#define SUIT_MAX_TILES 14               // 一门花色最多14张
+
+    // 5的幂，用于计算花色键
+    static const suit_key_t pow5_table[10] = { 1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125 };
+
+    // 单门花色的拆解结果（下称形状）
+    // 按“是否拆出雀头”和“面子数”分为2*5=10组，每组3bit，记录该条件下能拆出的最多搭子数+1
+    // 为0表示无法拆出这么多面子；搭子数超过4的按4计，因为面子与搭子之和超过4组的部分都是超载的
+    typedef uint32_t suit_shape_t;
+
+    // 解包后的形状
+    struct shape_t {
+        int8_t incomplete[2][5];  // [是否有雀头][面子数] = 最多搭子数，-1表示无法拆出
     };
 
-    // 当前工作状态
-    struct work_state_t {
-        work_path_t paths[MAX_STATE];  // 所有路径
-        intptr_t count;  // 路径数量
+    // 花色键到形状的表
+    struct shape_table_t {
+        suit_shape_t numbered[SUIT_KEY_NUMBERED_SIZE];  // 数牌
+        suit_shape_t honors[SUIT_KEY_HONORS_SIZE];  // 字牌
+        shape_table_t();
     };
 }
 
-// 路径是否来过了
-static bool is_basic_form_branch_exist(const intptr_t fixed_cnt, const work_path_t *work_path, const work_state_t *work_state) {
-    if (work_state->count <= 0 || work_path->depth == 0) {
-        return false;
-    }
-
-    // depth处有信息，所以按stl风格的end应该要+1
-    const uint16_t depth = static_cast<uint16_t>(work_path->depth + 1);
-
-    // std::includes要求有序，但又不能破坏当前数据
-    work_path_t temp;
-    std::copy(&work_path->units[fixed_cnt], &work_path->units[depth], &temp.units[fixed_cnt]);
-    std::sort(&temp.units[fixed_cnt], &temp.units[depth]);
-
-    return std::any_of(&work_state->paths[0], &work_state->paths[work_state->count],
-        [&temp, fixed_cnt, depth](const work_path_t &path) {
-        return std::includes(&path.units[fixed_cnt], &path.units[path.depth], &temp.units[fixed_cnt], &temp.units[depth]);
-    });
-}
-
-// 保存路径
-static void save_work_path(const intptr_t fixed_cnt, const work_path_t *work_path, work_state_t *work_state) {
-    // 复制一份数据，不破坏当前数据
-    work_path_t temp;
-    temp.depth = work_path->depth;
-    std::copy(&work_path->units[fixed_cnt], &work_path->units[temp.depth + 1], &temp.units[fixed_cnt]);
-    std::sort(&temp.units[fixed_cnt], &temp.units[temp.depth + 1]);
-
-    // 判断是否重复
-    if (std::none_of(&work_state->paths[0], &work_state->paths[work_state->count],
-        [&temp, fixed_cnt](const work_path_t &path) {
-        return (path.depth == temp.depth && std::equal(&path.units[fixed_cnt], &path.units[path.depth + 1], &temp.units[fixed_cnt]));
-    })) {
-        if (work_state->count < MAX_STATE) {
-            work_path_t &path = work_state->paths[work_state->count++];
-            path.depth = temp.depth;
-            std::copy(&temp.units[fixed_cnt], &temp.units[temp.depth + 1], &path.units[fixed_cnt]);
-        }
-        else {
-            assert(0 && "too many state!");
-        }
-    }
-}
-
-// 递归计算基本和型上听数
-// 参数说明：
-//   cnt_table牌表
-//   has_pair是否有雀头
-//   pack_cnt完成的面子数
-//   incomplete_cnt搭子数
-// 最后三个参数为优化性能用的，
-// work_path保存当前正在计算的路径，
-// work_state保存了所有已经计算过的路径，
-// 从0到fixed_cnt的数据是不使用的，这些保留给了副露的面子
-static int basic_form_shanten_recursively(tile_table_t &cnt_table, const bool has_pair, const unsigned pack_cnt, const unsigned incomplete_cnt,
-    const intptr_t fixed_cnt, work_path_t *work_path, work_state_t *work_state) {
-    if (fixed_cnt == 4) {  // 4副露
-        for (int i = 0; i < 34; ++i) {
-            tile_t t = all_tiles[i];
-            if (cnt_table[t] > 1) {
-                return -1;
-            }
-        }
-        return 0;
+// 解包形状
+static FORCE_INLINE void unpack_shape(suit_shape_t packed, shape_t *shape) {
+    int8_t *p = &shape->incomplete[0][0];
+    for (int i = 0; i < 10; ++i) {
+        p[i] = static_cast<int8_t>(static_cast<int>((packed >> (i * 3)) & 7U) - 1);
     }
+}
 
-    if (pack_cnt == 4) {  // 已经有4组面子
-        return has_pair ? -1 : 0;  // 如果有雀头，则和了；如果无雀头，则是听牌
+// 打包形状
+static FORCE_INLINE suit_shape_t pack_shape(const shape_t &shape) {
+    const int8_t *p = &shape.incomplete[0][0];
+    suit_shape_t packed = 0;
+    for (int i = 0; i < 10; ++i) {
+        packed |= static_cast<suit_shape_t>(p[i] + 1) << (i * 3);
     }
+    return packed;
+}
 
-    int max_ret;  // 当前状态能返回的最大上听数
+// 空的形状，即什么都没有拆出来
+static FORCE_INLINE void empty_shape(shape_t *shape) {
+    memset(shape, -1, sizeof(*shape));
+    shape->incomplete[0][0] = 0;
+}
 
-    // 算法说明：
-    // 缺少的面子数=4-完成的面子数
-    // 缺少的搭子数=缺少的面子数-已有的搭子数
-    // 两式合并：缺少的搭子数=4-完成的面子数-已有的搭子数
-    int incomplete_need = 4 - pack_cnt - incomplete_cnt;
-    if (incomplete_need > 0) {  // 还需要搭子的情况
-        // 有雀头时，上听数=已有的搭子数+缺少的搭子数*2-1
-        // 无雀头时，上听数=已有的搭子数+缺少的搭子数*2
-        max_ret = incomplete_cnt + incomplete_need * 2 - (has_pair ? 1 : 0);
-    }
-    else {  // 搭子齐了的情况
-        // 有雀头时，上听数=3-完成的面子数
-        // 无雀头时，上听数=4-完成的面子数
-        max_ret = (has_pair ? 3 : 4) - pack_cnt;
+// 在子牌型的形状上追加雀头、面子或搭子，更新到形状中
+static void absorb_shape(const shape_t &sub, int pair_add, int pack_add, int incomplete_add, shape_t *shape) {
+    for (int h = 0; h + pair_add < 2; ++h) {
+        for (int p = 0; p + pack_add < 5; ++p) {
+            int n = sub.incomplete[h][p];
+            if (n < 0) {
+                continue;
+            }
+            n = std::min(n + incomplete_add, 4);
+            int8_t &dst = shape->incomplete[h + pair_add][p + pack_add];
+            if (n > dst) {
+                dst = static_cast<int8_t>(n);
+            }
+        }
     }
+}
 
-    // 当前路径深度
-    const unsigned depth = pack_cnt + incomplete_cnt + has_pair;
-    work_path->depth = static_cast<uint16_t>(depth);
-
-    int result = max_ret;
-
-    if (pack_cnt + incomplete_cnt > 4) {  // 搭子超载
-        save_work_path(fixed_cnt, work_path, work_state);
-        return max_ret;
-    }
+// 构建一门花色的形状表
+// 按花色键从小到大构建，一个牌型中最小点数的牌，要么参与组成某个雀头、面子或搭子，要么是孤张
+// 削减掉这些牌之后，得到的花色键必然更小，其形状已经计算过了
+static void build_shape_table(suit_shape_t *table, int rank_cnt, bool numbered) {
+    const suit_key_t size = pow5_table[rank_cnt];
+    int cnt[9] = { 0 };
+    int sum = 0;
+
+    shape_t shape, sub;
+    empty_shape(&shape);
+    table[0] = pack_shape(shape);
+
+    for (suit_key_t key = 1; key < size; ++key) {
+        // 5进制自增
+        int r = 0;
+        while (cnt[r] == 4) {
+            cnt[r++] = 0;
+            sum -= 4;
+        }
+        ++cnt[r];
+        ++sum;
 
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 1) {
+        if (sum > SUIT_MAX_TILES) {  // 不可能出现的牌型
+            table[key] = 0;
             continue;
         }
 
-        // 雀头
-        if (!has_pair && cnt_table[t] > 1) {
-            work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_PAIR, t);  // 记录雀头
-            if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                // 削减雀头，递归
-                cnt_table[t] -= 2;
-                int ret = basic_form_shanten_recursively(cnt_table, true, pack_cnt, incomplete_cnt,
-                    fixed_cnt, work_path, work_state);
-                result = std::min(ret, result);
-                // 还原
-                cnt_table[t] += 2;
-            }
+        // 最小点数
+        int k = 0;
+        while (cnt[k] == 0) {
+            ++k;
         }
 
-        // 刻子
-        if (cnt_table[t] > 2) {
-            work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_PUNG, t);  // 记录刻子
-            if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                // 削减这组刻子，递归
-                cnt_table[t] -= 3;
-                int ret = basic_form_shanten_recursively(cnt_table, has_pair, pack_cnt + 1, incomplete_cnt,
-                    fixed_cnt, work_path, work_state);
-                result = std::min(ret, result);
-                // 还原
-                cnt_table[t] += 3;
-            }
+        memset(&shape, -1, sizeof(shape));
+
+        // 孤张
+        unpack_shape(table[key - pow5_table[k]], &sub);
+        absorb_shape(sub, 0, 0, 0, &shape);
+
+        if (cnt[k] > 1) {
+            // 雀头、刻子搭子
+            unpack_shape(table[key - 2 * pow5_table[k]], &sub);
+            absorb_shape(sub, 1, 0, 0, &shape);
+            absorb_shape(sub, 0, 0, 1, &shape);
+        }
+        if (cnt[k] > 2) {
+            // 刻子
+            unpack_shape(table[key - 3 * pow5_table[k]], &sub);
+            absorb_shape(sub, 0, 1, 0, &shape);
         }
 
-        // 顺子（只能是数牌）
-        bool is_numbered = is_numbered_suit(t);
-        // 顺子t t+1 t+2，显然t不能是8点以上的数牌
-        if (is_numbered && tile_get_rank(t) < 8 && cnt_table[t + 1] && cnt_table[t + 2]) {
-            work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_CHOW, t);  // 记录顺子
-            if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                // 削减这组顺子，递归
-                --cnt_table[t];
-                --cnt_table[t + 1];
-                --cnt_table[t + 2];
-                int ret = basic_form_shanten_recursively(cnt_table, has_pair, pack_cnt + 1, incomplete_cnt,
-                    fixed_cnt, work_path, work_state);
-                result = std::min(ret, result);
-                // 还原
-                ++cnt_table[t];
-                ++cnt_table[t + 1];
-                ++cnt_table[t + 2];
+        if (numbered) {
+            // 两面或者边张搭子
+            if (k < 8 && cnt[k + 1]) {
+                unpack_shape(table[key - pow5_table[k] - pow5_table[k + 1]], &sub);
+                absorb_shape(sub, 0, 0, 1, &shape);
+            }
+            if (k < 7 && cnt[k + 2]) {
+                // 嵌张搭子
+                unpack_shape(table[key - pow5_table[k] - pow5_table[k + 2]], &sub);
+                absorb_shape(sub, 0, 0, 1, &shape);
+
+                // 顺子
+                if (cnt[k + 1]) {
+                    unpack_shape(table[key - pow5_table[k] - pow5_table[k + 1] - pow5_table[k + 2]], &sub);
+                    absorb_shape(sub, 0, 1, 0, &shape);
+                }
             }
         }
 
-        // 如果已经通过削减雀头/面子降低了上听数，再按搭子计算的上听数肯定不会更少
-        if (result < max_ret) {
-            continue;
-        }
+        table[key] = pack_shape(shape);
+    }
+}
 
-        // 刻子搭子
-        if (cnt_table[t] > 1) {
-            work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_INCOMPLETE_PUNG, t);  // 记录刻子搭子
-            if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                // 削减刻子搭子，递归
-                cnt_table[t] -= 2;
-                int ret = basic_form_shanten_recursively(cnt_table, has_pair, pack_cnt, incomplete_cnt + 1,
-                    fixed_cnt, work_path, work_state);
-                result = std::min(ret, result);
-                // 还原
-                cnt_table[t] += 2;
-            }
+shape_table_t::shape_table_t() {
+    build_shape_table(numbered, 9, true);
+    build_shape_table(honors, 7, false);
+}
+
+// 获取形状表，首次使用时构建
+static const shape_table_t &get_shape_table() {
+    static const shape_table_t *table = new shape_table_t;  // C++11保证局部静态变量初始化是线程安全的
+    return *table;
+}
+
+// 计算一门花色的花色键
+// 某张牌超过4枚时，返回false
+static FORCE_INLINE bool make_suit_key(const tile_table_t &cnt_table, suit_t suit, suit_key_t *key) {
+    const int rank_cnt = (suit == TILE_SUIT_HONORS) ? 7 : 9;
+    const uint16_t *cnt = &cnt_table[make_tile(suit, 1)];
+    suit_key_t k = 0;
+    for (int r = rank_cnt; r-- > 0; ) {
+        if (cnt[r] > 4) {
+            return false;
         }
+        k = k * 5 + cnt[r];
+    }
+    *key = k;
+    return true;
+}
 
-        // 顺子搭子（只能是数牌）
-        if (is_numbered) {
-            // 两面或者边张搭子t t+1，显然t不能是9点以上的数牌
-            if (tile_get_rank(t) < 9 && cnt_table[t + 1]) {  // 两面或者边张
-                work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_CHOW_OPEN_END, t);  // 记录两面或者边张搭子
-                if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                    // 削减搭子，递归
-                    --cnt_table[t];
-                    --cnt_table[t + 1];
-                    int ret = basic_form_shanten_recursively(cnt_table, has_pair, pack_cnt, incomplete_cnt + 1,
-                        fixed_cnt, work_path, work_state);
-                    result = std::min(ret, result);
-                    // 还原
-                    ++cnt_table[t];
-                    ++cnt_table[t + 1];
-                }
+// 由紧凑的计数计算一门花色的花色键
+// 某张牌超过4枚时，返回false
+static FORCE_INLINE bool make_suit_key(const tile_counts_t &counts, suit_t suit, suit_key_t *key) {
+    const uint32_t word = tile_counts_suit(counts, suit);
+    if (tile_counts_more_than_4(word) != 0) {
+        return false;
+    }
+    // 字牌的第8、9位总是0，不影响结果
+    suit_key_t k = 0;
+    for (int r = 9; r-- > 0; ) {
+        k = k * 5 + ((word >> (r * 3)) & 7);
+    }
+    *key = k;
+    return true;
+}
+
+// 查一门花色的形状
+static FORCE_INLINE void lookup_shape(const shape_table_t &table, suit_t suit, suit_key_t key, shape_t *shape) {
+    unpack_shape(suit == TILE_SUIT_HONORS ? table.honors[key] : table.numbered[key], shape);
+}
+
+// 合并两门花色的形状
+static void merge_shape(const shape_t &a, const shape_t &b, shape_t *shape) {
+    memset(shape, -1, sizeof(*shape));
+    for (int ha = 0; ha < 2; ++ha) {
+        for (int pa = 0; pa < 5; ++pa) {
+            int na = a.incomplete[ha][pa];
+            if (na < 0) {
+                continue;
             }
-            // 嵌张搭子t t+2，显然t不能是8点以上的数牌
-            if (tile_get_rank(t) < 8 && cnt_table[t + 2]) {  // 嵌张
-                work_path->units[depth] = MAKE_UNIT(UNIT_TYPE_CHOW_CLOSED, t);  // 记录嵌张搭子
-                if (!is_basic_form_branch_exist(fixed_cnt, work_path, work_state)) {
-                    // 削减搭子，递归
-                    --cnt_table[t];
-                    --cnt_table[t + 2];
-                    int ret = basic_form_shanten_recursively(cnt_table, has_pair, pack_cnt, incomplete_cnt + 1,
-                        fixed_cnt, work_path, work_state);
-                    result = std::min(ret, result);
-                    // 还原
-                    ++cnt_table[t];
-                    ++cnt_table[t + 2];
+            for (int hb = 0; ha + hb < 2; ++hb) {
+                for (int pb = 0; pa + pb < 5; ++pb) {
+                    int nb = b.incomplete[hb][pb];
+                    if (nb < 0) {
+                        continue;
+                    }
+                    int n = std::min(na + nb, 4);
+                    int8_t &dst = shape->incomplete[ha + hb][pa + pb];
+                    if (n > dst) {
+                        dst = static_cast<int8_t>(n);
+                    }
                 }
             }
         }
     }
+}
 
-    if (result == max_ret) {
-        save_work_path(fixed_cnt, work_path, work_state);
+// 由形状计算上听数
+// 算法说明：
+// 缺少的面子数=4-完成的面子数
+// 缺少的搭子数=缺少的面子数-已有的搭子数
+// 有雀头时，上听数=已有的搭子数+缺少的搭子数*2-1，无雀头时不减1
+// 搭子齐了（即搭子数不少于缺少的面子数）时，多出的搭子不起作用
+// 整理得：上听数=8-完成的面子数*2-min(已有的搭子数, 缺少的面子数)-有无雀头
+// 副露组数FixedCnt为模板参数，循环边界为常量，按0~4分别生成展开的版本
+template <intptr_t FixedCnt>
+static int shape_shanten(const shape_t &shape) {
+    int result = std::numeric_limits<int>::max();
+    for (int h = 0; h < 2; ++h) {
+        for (int p = 0; p + FixedCnt < 5; ++p) {
+            int n = shape.incomplete[h][p];
+            if (n < 0) {
+                continue;
+            }
+            int pack_cnt = p + static_cast<int>(FixedCnt);
+            int ret = 8 - pack_cnt * 2 - std::min(n, 4 - pack_cnt) - h;
+            if (ret < result) {
+                result = ret;
+            }
+        }
     }
-
     return result;
 }
 
-// 数牌是否有搭子
-static bool numbered_tile_has_neighbor(const tile_table_t &cnt_table, tile_t t) {
-    rank_t r = tile_get_rank(t);
-    if (r < 9) { if (cnt_table[t + 1]) return true; }
-    if (r < 8) { if (cnt_table[t + 2]) return true; }
-    if (r > 1) { if (cnt_table[t - 1]) return true; }
-    if (r > 2) { if (cnt_table[t - 2]) return true; }
-    return false;
+// 合并两门花色的形状并计算上听数，相当于merge_shape之后shape_shanten，但不生成中间结果
+template <intptr_t FixedCnt>
+static int merged_shape_shanten(const shape_t &a, const shape_t &b) {
+    int result = std::numeric_limits<int>::max();
+    for (int ha = 0; ha < 2; ++ha) {
+        for (int pa = 0; pa + FixedCnt < 5; ++pa) {
+            int na = a.incomplete[ha][pa];
+            if (na < 0) {
+                continue;
+            }
+            for (int hb = 0; ha + hb < 2; ++hb) {
+                for (int pb = 0; pa + pb + FixedCnt < 5; ++pb) {
+                    int nb = b.incomplete[hb][pb];
+                    if (nb < 0) {
+                        continue;
+                    }
+                    int pack_cnt = pa + pb + static_cast<int>(FixedCnt);
+                    int ret = 8 - pack_cnt * 2 - std::min(na + nb, 4 - pack_cnt) - ha - hb;
+                    if (ret < result) {
+                        result = ret;
+                    }
+                }
+            }
+        }
+    }
+    return result;
 }
 
-// 以表格为参数计算基本和型上听数
-static int basic_form_shanten_from_table(tile_table_t &cnt_table, intptr_t fixed_cnt, useful_table_t *useful_table) {
-    // 计算上听数
-    work_path_t work_path;
-    work_state_t work_state;
-    work_state.count = 0;
-    int result = basic_form_shanten_recursively(cnt_table, false, static_cast<uint16_t>(fixed_cnt), 0,
-        fixed_cnt, &work_path, &work_state);
-
-    if (useful_table == nullptr) {
-        return result;
+// 按副露组数分派到特化的版本
+static int merged_shape_shanten(const shape_t &a, const shape_t &b, intptr_t fixed_cnt) {
+    switch (fixed_cnt) {
+    case 0: return merged_shape_shanten<0>(a, b);
+    case 1: return merged_shape_shanten<1>(a, b);
+    case 2: return merged_shape_shanten<2>(a, b);
+    case 3: return merged_shape_shanten<3>(a, b);
+    case 4: return merged_shape_shanten<4>(a, b);
+    default: return std::numeric_limits<int>::max();
     }
+}
 
-    // 穷举所有的牌，获取能减少上听数的牌
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] == 4 && result > 0) {
-            continue;
+// 由各门花色的花色键，以及各门花色之外其余花色的合并结果，获取基本和型的有效牌
+// 穷举所有的牌，每张牌只影响其所在的一门花色，获取能减少上听数的牌
+template <intptr_t FixedCnt>
+static void basic_form_useful_from_shapes(const tile_counts_t &counts, const suit_key_t (&keys)[4], const shape_t (&others)[4],
+    int result, useful_table_t *useful_table) {
+    const shape_table_t &table = get_shape_table();
+
+    for (int i = 0; i < 4; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        int rank_cnt = (suit == TILE_SUIT_HONORS) ? 7 : 9;
+
+        // 候选的牌：手中有的牌，以及数牌中与之相距1或2的牌；孤张字牌和不靠张的数牌都无法减少上听数
+        // 已经有4枚的牌用完了，也不是候选
+        const uint32_t word = tile_counts_suit(counts, suit);
+        const uint64_t occupied = tile_counts_at_least_1(word);
+        uint64_t candidates = occupied;
+        if (suit != TILE_SUIT_HONORS) {
+            candidates |= ((occupied << 3) | (occupied << 6) | (occupied >> 3) | (occupied >> 6)) & (TILE_COUNTS_LOW_BITS & TILE_COUNTS_SUIT_BITS);
         }
+        candidates &= ~tile_counts_at_least_4(word);
 
-        if (cnt_table[t] == 0) {
-            // 跳过孤张字牌和不靠张的数牌，这些牌都无法减少上听数
-            if (is_honor(t) || !numbered_tile_has_neighbor(cnt_table, t)) {
+        for (int r = 0; r < rank_cnt; ++r) {
+            if (!((candidates >> (r * 3)) & 1)) {
                 continue;
             }
+
+            shape_t shape;
+            lookup_shape(table, suit, keys[i] + pow5_table[r], &shape);
+            if (merged_shape_shanten<FixedCnt>(shape, others[i]) < result) {
+                (*useful_table)[make_tile(suit, static_cast<rank_t>(r + 1))] = true;  // 标记为有效牌
+            }
         }
+    }
+}
+
+// 按副露组数分派到特化的版本
+static void basic_form_useful_from_shapes(const tile_counts_t &counts, const suit_key_t (&keys)[4], const shape_t (&others)[4],
+    intptr_t fixed_cnt, int result, useful_table_t *useful_table) {
+    switch (fixed_cnt) {
+    case 0: basic_form_useful_from_shapes<0>(counts, keys, others, result, useful_table); break;
+    case 1: basic_form_useful_from_shapes<1>(counts, keys, others, result, useful_table); break;
+    case 2: basic_form_useful_from_shapes<2>(counts, keys, others, result, useful_table); break;
+    case 3: basic_form_useful_from_shapes<3>(counts, keys, others, result, useful_table); break;
+    case 4: basic_form_useful_from_shapes<4>(counts, keys, others, result, useful_table); break;
+    default: break;
+    }
+}
 
-        ++cnt_table[t];
-        work_state.count = 0;
-        int temp = basic_form_shanten_recursively(cnt_table, false, static_cast<uint16_t>(fixed_cnt), 0,
-            fixed_cnt, &work_path, &work_state);
-        if (temp < result) {
-            (*useful_table)[t] = true;  // 标记为有效牌
+// 以紧凑的计数为参数计算基本和型上听数
+// 分别查出4门花色的形状，合并后计算上听数
+template <intptr_t FixedCnt>
+static int basic_form_shanten_from_counts(const tile_counts_t &counts, useful_table_t *useful_table) {
+    const shape_table_t &table = get_shape_table();
+
+    suit_key_t keys[4];
+    shape_t shapes[4];
+    for (int i = 0; i < 4; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        if (!make_suit_key(counts, suit, &keys[i])) {
+            return std::numeric_limits<int>::max();
         }
-        --cnt_table[t];
+        lookup_shape(table, suit, keys[i], &shapes[i]);
     }
 
+    // prefix[i]为前i门花色的合并结果，suffix[i]为第i门及之后花色的合并结果
+    shape_t prefix[5], suffix[5];
+    empty_shape(&prefix[0]);
+    empty_shape(&suffix[4]);
+    for (int i = 0; i < 4; ++i) {
+        merge_shape(prefix[i], shapes[i], &prefix[i + 1]);
+        merge_shape(suffix[4 - i], shapes[3 - i], &suffix[3 - i]);
+    }
+
+    // 计算上听数
+    int result = shape_shanten<FixedCnt>(prefix[4]);
+
+    if (useful_table == nullptr) {
+        return result;
+    }
+
+    // 各门花色之外其余3门花色的合并结果
+    shape_t others[4];
+    for (int i = 0; i < 4; ++i) {
+        merge_shape(prefix[i], suffix[i + 1], &others[i]);
+    }
+    basic_form_useful_from_shapes<FixedCnt>(counts, keys, others, result, useful_table);
+
     return result;
 }
 
+// 按副露组数分派到特化的版本
+static int basic_form_shanten_from_counts(const tile_counts_t &counts, intptr_t fixed_cnt, useful_table_t *useful_table) {
+    switch (fixed_cnt) {
+    case 0: return basic_form_shanten_from_counts<0>(counts, useful_table);
+    case 1: return basic_form_shanten_from_counts<1>(counts, useful_table);
+    case 2: return basic_form_shanten_from_counts<2>(counts, useful_table);
+    case 3: return basic_form_shanten_from_counts<3>(counts, useful_table);
+    case 4: return basic_form_shanten_from_counts<4>(counts, useful_table);
+    default: return std::numeric_limits<int>::max();
+    }
+}
+
 // 基本和型上听数
 int basic_form_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table) {
     if (standing_tiles == nullptr || (standing_cnt != 13
@@ -424,165 +565,197 @@ int basic_form_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, usef
         return std::numeric_limits<int>::max();
     }
 
-    // 对立牌的种类进行打表
-    tile_table_t cnt_table;
-    map_tiles(standing_tiles, standing_cnt, &cnt_table);
-
     if (useful_table != nullptr) {
         memset(*useful_table, 0, sizeof(*useful_table));
     }
-    return basic_form_shanten_from_table(cnt_table, (13 - standing_cnt) / 3, useful_table);
+
+    // 将立牌记入紧凑的计数
+    tile_counts_t counts;
+    if (!map_tile_counts(standing_tiles, standing_cnt, &counts)) {
+        return std::numeric_limits<int>::max();
+    }
+    return basic_form_shanten_from_counts(counts, (13 - standing_cnt) / 3, useful_table);
 }
 
-// 基本和型判断1张是否听牌
-static bool is_basic_form_wait_1(tile_table_t &cnt_table, useful_table_t *waiting_table) {
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] != 1) {
+namespace {
+
+    // 单门花色的完成状态与听牌（下称完成形状）
+    // 低9位为听牌点数的掩码，第1位对应1点；最高位为该牌型是否已经完成
+    // 已经完成是指能拆解为若干面子，张数模3余2时再加一组雀头
+    typedef uint16_t suit_wait_t;
+
+#define SUIT_WAIT_COMPLETE 0x8000U
+
+    // 花色键到完成形状的表
+    struct wait_table_t {
+        suit_wait_t numbered[SUIT_KEY_NUMBERED_SIZE];  // 数牌
+        suit_wait_t honors[SUIT_KEY_HONORS_SIZE];  // 字牌
+        wait_table_t();
+    };
+}
+
+// 构建一门花色的完成形状表
+static void build_wait_table(suit_wait_t *table, int rank_cnt, bool numbered) {
+    const suit_key_t size = pow5_table[rank_cnt];
+    int cnt[9] = { 0 };
+    int sum = 0;
+
+    // 第一遍：判断是否已经完成
+    // 一个牌型中最小点数的牌，要么组成刻子，要么组成雀头，要么作为顺子的第一张
+    table[0] = SUIT_WAIT_COMPLETE;
+    for (suit_key_t key = 1; key < size; ++key) {
+        // 5进制自增
+        int r = 0;
+        while (cnt[r] == 4) {
+            cnt[r++] = 0;
+            sum -= 4;
+        }
+        ++cnt[r];
+        ++sum;
+
+        table[key] = 0;
+        if (sum > SUIT_MAX_TILES || sum % 3 == 1) {
             continue;
         }
 
-        // 单钓将
-        cnt_table[t] = 0;
-        if (std::all_of(std::begin(cnt_table), std::end(cnt_table), [](int n) { return n == 0; })) {
-            cnt_table[t] = 1;
-            if (waiting_table != nullptr) {  // 不需要获取听牌张，则可以直接返回
-                (*waiting_table)[t] = true;
-            }
-            return true;
+        // 最小点数
+        int k = 0;
+        while (cnt[k] == 0) {
+            ++k;
+        }
+
+        bool complete = false;
+        if (cnt[k] > 2) {  // 刻子
+            complete = !!(table[key - 3 * pow5_table[k]] & SUIT_WAIT_COMPLETE);
+        }
+        if (!complete && cnt[k] > 1 && sum % 3 == 2) {  // 雀头
+            complete = !!(table[key - 2 * pow5_table[k]] & SUIT_WAIT_COMPLETE);
+        }
+        if (!complete && numbered && k < 7 && cnt[k + 1] && cnt[k + 2]) {  // 顺子
+            complete = !!(table[key - pow5_table[k] - pow5_table[k + 1] - pow5_table[k + 2]] & SUIT_WAIT_COMPLETE);
+        }
+        if (complete) {
+            table[key] = SUIT_WAIT_COMPLETE;
         }
-        cnt_table[t] = 1;
     }
 
-    return false;
-}
+    // 第二遍：计算听牌
+    // 加上一张牌之后能完成的，即为听这张牌
+    memset(cnt, 0, sizeof(cnt));
+    sum = 0;
+    for (suit_key_t key = 1; key < size; ++key) {
+        int r = 0;
+        while (cnt[r] == 4) {
+            cnt[r++] = 0;
+            sum -= 4;
+        }
+        ++cnt[r];
+        ++sum;
 
-// 基本和型判断2张是否听牌
-static bool is_basic_form_wait_2(const tile_table_t &cnt_table, useful_table_t *waiting_table) {
-    bool ret = false;
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 1) {
+        if (sum >= SUIT_MAX_TILES || sum % 3 == 0) {
             continue;
         }
-        if (cnt_table[t] > 1) {
-            if (waiting_table != nullptr) {  // 获取听牌张
-                (*waiting_table)[t] = true;  // 对倒
-                ret = true;
-                continue;
-            }
-            else {  // 不需要获取听牌张，则可以直接返回
-                return true;
+
+        suit_wait_t mask = 0;
+        for (int i = 0; i < rank_cnt; ++i) {
+            bool complete;
+            if (cnt[i] < 4) {
+                complete = !!(table[key + pow5_table[i]] & SUIT_WAIT_COMPLETE);
             }
-        }
-        if (is_numbered_suit_quick(t)) {  // 数牌搭子
-            rank_t r = tile_get_rank(t);
-            if (r > 1 && cnt_table[t - 1]) {  // 两面或者边张
-                if (waiting_table != nullptr) {  // 获取听牌张
-                    if (r < 9) (*waiting_table)[t + 1] = true;
-                    if (r > 2) (*waiting_table)[t - 2] = true;
-                    ret = true;
-                    continue;
-                }
-                else {  // 不需要获取听牌张，则可以直接返回
-                    return true;
+            else {
+                // 已经有4枚的，第5枚只能与其中2枚组成刻子，或者与其中1枚组成雀头，其余的都在顺子里
+                complete = !!(table[key - 2 * pow5_table[i]] & SUIT_WAIT_COMPLETE);
+                if (!complete && sum % 3 == 1) {
+                    complete = !!(table[key - pow5_table[i]] & SUIT_WAIT_COMPLETE);
                 }
             }
-            if (r > 2 && cnt_table[t - 2]) {  // 嵌张
-                if (waiting_table != nullptr) {  // 获取听牌张
-                    (*waiting_table)[t - 1] = true;
-                    ret = true;
-                    continue;
-                }
-                else {  // 不需要获取听牌张，则可以直接返回
-                    return true;
-                }
+            if (complete) {
+                mask |= 1U << i;
             }
         }
+        table[key] |= mask;
     }
-    return ret;
 }
 
-// 基本和型判断4张是否听牌
-static bool is_basic_form_wait_4(tile_table_t &cnt_table, useful_table_t *waiting_table) {
-    bool ret = false;
-    // 削减雀头
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 2) {
-            continue;
+wait_table_t::wait_table_t() {
+    build_wait_table(numbered, 9, true);
+    build_wait_table(honors, 7, false);
+}
+
+// 获取完成形状表，首次使用时构建
+static const wait_table_t &get_wait_table() {
+    static const wait_table_t *table = new wait_table_t;  // C++11保证局部静态变量初始化是线程安全的
+    return *table;
+}
+
+// 查一门花色的完成形状
+static FORCE_INLINE suit_wait_t lookup_wait(const wait_table_t &table, suit_t suit, suit_key_t key) {
+    return suit == TILE_SUIT_HONORS ? table.honors[key] : table.numbered[key];
+}
+
+// 以紧凑的计数为参数判断基本和型是否听牌
+// 听牌时，必然是恰有1门花色张数模3余1，其余花色都已完成且不含雀头，听的是这门花色中的牌；
+// 或者恰有2门花色张数模3余2，其余花色都已完成且不含雀头，这2门中一门完成时，听另一门中的牌
+static bool is_basic_form_wait_from_counts(const tile_counts_t &counts, useful_table_t *waiting_table) {
+    const wait_table_t &table = get_wait_table();
+
+    suit_wait_t waits[4];
+    int remainder_cnt[3] = { 0 };
+    int remainder_suit[3][4];
+    for (int i = 0; i < 4; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        suit_key_t key;
+        if (!make_suit_key(counts, suit, &key)) {
+            return false;
         }
-        // 削减雀头，递归
-        cnt_table[t] -= 2;
-        if (is_basic_form_wait_2(cnt_table, waiting_table)) {
-            ret = true;
+        int sum = tile_counts_sum(tile_counts_suit(counts, suit));
+        if (sum > SUIT_MAX_TILES) {
+            return false;
         }
-        // 还原
-        cnt_table[t] += 2;
-        if (ret && waiting_table == nullptr) {  // 不需要获取听牌张，则可以直接结束递归
-            return true;
+        waits[i] = lookup_wait(table, suit, key);
+        int remainder = sum % 3;
+        if (remainder == 0 && !(waits[i] & SUIT_WAIT_COMPLETE)) {  // 不含雀头的花色必须是完成的
+            return false;
         }
+        remainder_suit[remainder][remainder_cnt[remainder]++] = i;
     }
 
-    return ret;
-}
-
-// 递归计算基本和型是否听牌
-static bool is_basic_form_wait_recursively(tile_table_t &cnt_table, intptr_t left_cnt, useful_table_t *waiting_table) {
-    if (left_cnt == 1) {
-        return is_basic_form_wait_1(cnt_table, waiting_table);
+    // 各门花色的听牌张数掩码
+    suit_wait_t masks[4] = { 0 };
+    if (remainder_cnt[1] == 1 && remainder_cnt[2] == 0) {
+        int i = remainder_suit[1][0];
+        masks[i] = waits[i] & 0x1FFU;
     }
-
-    bool ret = false;
-    if (left_cnt == 4) {
-        ret = is_basic_form_wait_4(cnt_table, waiting_table);
-        if (ret && waiting_table == nullptr) {  // 不需要获取听牌张，则可以直接结束递归
-            return true;
+    else if (remainder_cnt[1] == 0 && remainder_cnt[2] == 2) {
+        int i = remainder_suit[2][0], j = remainder_suit[2][1];
+        if (waits[j] & SUIT_WAIT_COMPLETE) {
+            masks[i] = waits[i] & 0x1FFU;
         }
+        if (waits[i] & SUIT_WAIT_COMPLETE) {
+            masks[j] = waits[j] & 0x1FFU;
+        }
+    }
+    else {
+        return false;
     }
 
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 1) {
+    bool ret = false;
+    for (int i = 0; i < 4; ++i) {
+        if (masks[i] == 0) {
             continue;
         }
-
-        // 刻子
-        if (cnt_table[t] > 2) {
-            // 削减这组刻子，递归
-            cnt_table[t] -= 3;
-            if (is_basic_form_wait_recursively(cnt_table, left_cnt - 3, waiting_table)) {
-                ret = true;
-            }
-            // 还原
-            cnt_table[t] += 3;
-            if (ret && waiting_table == nullptr) {  // 不需要获取听牌张，则可以直接结束递归
-                return true;
-            }
+        ret = true;
+        if (waiting_table == nullptr) {  // 不需要获取听牌张，则可以直接返回
+            break;
         }
-
-        // 顺子（只能是数牌）
-        if (is_numbered_suit(t)) {
-            // 顺子t t+1 t+2，显然t不能是8点以上的数牌
-            if (tile_get_rank(t) < 8 && cnt_table[t + 1] && cnt_table[t + 2]) {
-                // 削减这组顺子，递归
-                --cnt_table[t];
-                --cnt_table[t + 1];
-                --cnt_table[t + 2];
-                if (is_basic_form_wait_recursively(cnt_table, left_cnt - 3, waiting_table)) {
-                    ret = true;
-                }
-                // 还原
-                ++cnt_table[t];
-                ++cnt_table[t + 1];
-                ++cnt_table[t + 2];
-                if (ret && waiting_table == nullptr) {  // 不需要获取听牌张，则可以直接结束递归
-                    return true;
-                }
+        // 获取听牌张
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        for (int r = 0; r < 9; ++r) {
+            if (masks[i] & (1U << r)) {
+                (*waiting_table)[make_tile(suit, static_cast<rank_t>(r + 1))] = true;
             }
         }
     }
-
     return ret;
 }
 
@@ -590,112 +763,166 @@ static bool is_basic_form_wait_recursively(tile_table_t &cnt_table, intptr_t lef
 // 这里之所以不用直接调用上听数计算函数，判断其返回值为0的方式
 // 是因为前者会削减搭子，这个操作在和牌判断中是没必要的，所以单独写一套更快逻辑
 bool is_basic_form_wait(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *waiting_table) {
-    // 对立牌的种类进行打表
-    tile_table_t cnt_table;
-    map_tiles(standing_tiles, standing_cnt, &cnt_table);
-
     if (waiting_table != nullptr) {
         memset(*waiting_table, 0, sizeof(*waiting_table));
     }
-    return is_basic_form_wait_recursively(cnt_table, standing_cnt, waiting_table);
-}
 
-// 基本和型2张能否和牌
-static bool is_basic_form_win_2(const tile_table_t &cnt_table) {
-    // 找到未使用的牌
-    typedef std::remove_all_extents<tile_table_t>::type table_elem_t;
-    const table_elem_t *it = std::find_if(std::begin(cnt_table), std::end(cnt_table), [](table_elem_t n) { return n > 0; });
-    // 存在且张数等于2
-    if (it == std::end(cnt_table) || *it != 2) {
+    // 将立牌记入紧凑的计数
+    tile_counts_t counts;
+    if (!map_tile_counts(standing_tiles, standing_cnt, &counts)) {
         return false;
     }
-    // 还有其他未使用的牌
-    return std::none_of(it + 1, std::end(cnt_table), [](int n) { return n > 0; });
+    return is_basic_form_wait_from_counts(counts, waiting_table);
 }
 
-// 递归计算基本和型是否和牌
-// 这里之所以不用直接调用上听数计算函数，判断其返回值为-1的方式，
-// 是因为前者会削减搭子，这个操作在和牌判断中是没必要的，所以单独写一套更快逻辑
-static bool is_basic_form_win_recursively(tile_table_t &cnt_table, intptr_t left_cnt) {
-    if (left_cnt == 2) {
-        return is_basic_form_win_2(cnt_table);
+// 判断一门花色是否已经完成，返回张数，未完成时返回-1
+// 和牌判断时，测试的牌可能是第5枚，此时该牌只能与其中2枚组成刻子，或者与其中1枚组成雀头
+static int suit_complete_cnt(const wait_table_t &table, const tile_counts_t &counts, suit_t suit) {
+    const int rank_cnt = (suit == TILE_SUIT_HONORS) ? 7 : 9;
+    const uint32_t word = tile_counts_suit(counts, suit);
+    suit_key_t key = 0;
+    int fifth = -1;  // 第5枚的点数
+    for (int r = rank_cnt; r-- > 0; ) {
+        int n = (word >> (r * 3)) & 7;
+        if (n > 4) {
+            if (n > 5 || fifth != -1) {
+                return -1;
+            }
+            fifth = r;
+            n = 4;
+        }
+        key = key * 5 + n;
+    }
+    const int sum = tile_counts_sum(word);
+    if (sum > SUIT_MAX_TILES || sum % 3 == 1) {
+        return -1;
     }
 
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 1) {
-            continue;
+    bool complete;
+    if (fifth == -1) {
+        complete = !!(lookup_wait(table, suit, key) & SUIT_WAIT_COMPLETE);
+    }
+    else {
+        complete = !!(lookup_wait(table, suit, key - 2 * pow5_table[fifth]) & SUIT_WAIT_COMPLETE);
+        if (!complete && sum % 3 == 2) {
+            complete = !!(lookup_wait(table, suit, key - pow5_table[fifth]) & SUIT_WAIT_COMPLETE);
         }
+    }
+    return complete ? sum : -1;
+}
 
-        // 刻子
-        if (cnt_table[t] > 2) {
-            // 削减这组刻子，递归
-            cnt_table[t] -= 3;
-            bool ret = is_basic_form_win_recursively(cnt_table, left_cnt - 3);
-            // 还原
-            cnt_table[t] += 3;
-            if (ret) {
-                return true;
-            }
-        }
+// 以紧凑的计数为参数判断基本和型是否和牌
+// 各门花色都要完成，并且恰有1门花色含雀头
+static bool is_basic_form_win_from_counts(const tile_counts_t &counts) {
+    const wait_table_t &table = get_wait_table();
 
-        // 顺子（只能是数牌）
-        if (is_numbered_suit(t)) {
-            // 顺子t t+1 t+2，显然t不能是8点以上的数牌
-            if (tile_get_rank(t) < 8 && cnt_table[t + 1] && cnt_table[t + 2]) {
-                // 削减这组顺子，递归
-                --cnt_table[t];
-                --cnt_table[t + 1];
-                --cnt_table[t + 2];
-                bool ret = is_basic_form_win_recursively(cnt_table, left_cnt - 3);
-                // 还原
-                ++cnt_table[t];
-                ++cnt_table[t + 1];
-                ++cnt_table[t + 2];
-                if (ret) {
-                    return true;
-                }
-            }
+    int pair_cnt = 0;
+    for (int i = 0; i < 4; ++i) {
+        int sum = suit_complete_cnt(table, counts, static_cast<suit_t>(TILE_SUIT_CHARACTERS + i));
+        if (sum < 0) {
+            return false;
+        }
+        if (sum % 3 == 2) {
+            ++pair_cnt;
         }
     }
-
-    return false;
+    return pair_cnt == 1;
 }
 
 // 基本和型是否和牌
+// 这里之所以不用直接调用上听数计算函数，判断其返回值为-1的方式，
+// 是因为前者会削减搭子，这个操作在和牌判断中是没必要的，所以单独写一套更快逻辑
 bool is_basic_form_win(const tile_t *standing_tiles, intptr_t standing_cnt, tile_t test_tile) {
-    // 对立牌的种类进行打表
-    tile_table_t cnt_table;
-    map_tiles(standing_tiles, standing_cnt, &cnt_table);
-    ++cnt_table[test_tile];  // 添加测试的牌
-    return is_basic_form_win_recursively(cnt_table, standing_cnt + 1);
+    // 将立牌记入紧凑的计数
+    tile_counts_t counts;
+    if (!map_tile_counts(standing_tiles, standing_cnt, &counts)) {
+        return false;
+    }
+    if (is_tile_countable(test_tile)) {  // 添加测试的牌
+        if (tile_counts_get(counts, test_tile) == 7) {
+            return false;
+        }
+        tile_counts_add(&counts, test_tile);
+    }
+    return is_basic_form_win_from_counts(counts);
+}
+
+//-------------------------------- 特殊和型的牌集合 --------------------------------
+
+namespace {
+
+    // 按枚数划分的牌集合，has[k]为拥有至少k+1枚的牌
+    // 特殊和型只关心各种牌有没有、成不成对，用这些集合做位运算即可，不需要逐张遍历牌表
+    struct count_sets_t {
+        tile_set_t has[4];
+    };
+}
+
+// 一门数牌内的点数集合，第0位为1点
+#define RANK_SET_147 0x049ULL
+#define RANK_SET_258 0x092ULL
+#define RANK_SET_369 0x124ULL
+#define RANK_SET_19 0x101ULL
+
+// 由万子、条子、饼子的点数集合组成牌集合
+#define TILE_SET_NUMBERED(m_, s_, p_) ((m_) | ((s_) << 9) | ((p_) << 18))
+
+#define TILE_SET_HONORS (0x7FULL << 27)  // 字牌
+#define TILE_SET_THIRTEEN_ORPHANS (TILE_SET_NUMBERED(RANK_SET_19, RANK_SET_19, RANK_SET_19) | TILE_SET_HONORS)  // 幺九牌
+
+// 6种组合龙的牌集合，与standard_knitted_straight的顺序一致
+static const tile_set_t knitted_straight_sets[6] = {
+    TILE_SET_NUMBERED(RANK_SET_147, RANK_SET_258, RANK_SET_369),
+    TILE_SET_NUMBERED(RANK_SET_147, RANK_SET_369, RANK_SET_258),
+    TILE_SET_NUMBERED(RANK_SET_258, RANK_SET_147, RANK_SET_369),
+    TILE_SET_NUMBERED(RANK_SET_258, RANK_SET_369, RANK_SET_147),
+    TILE_SET_NUMBERED(RANK_SET_369, RANK_SET_147, RANK_SET_258),
+    TILE_SET_NUMBERED(RANK_SET_369, RANK_SET_258, RANK_SET_147),
+};
+
+// 由牌表生成按枚数划分的牌集合
+static void make_count_sets(const tile_table_t &cnt_table, count_sets_t *sets) {
+    memset(sets, 0, sizeof(*sets));
+    for (int i = 0; i < 34; ++i) {
+        int n = cnt_table[all_tiles[i]];
+        for (int k = 0; k < n && k < 4; ++k) {
+            sets->has[k] |= 1ULL << i;
+        }
+    }
+}
+
+// 牌集合中减少一张牌，n为减少之后的枚数
+static FORCE_INLINE void count_sets_remove_tile(count_sets_t *sets, tile_t tile, int n) {
+    sets->has[n] &= ~make_tile_set(tile);
 }
 
 //-------------------------------- 七对 --------------------------------
 
+// 以牌集合为参数计算七对上听数
+static int seven_pairs_shanten_from_sets(const count_sets_t &sets, useful_table_t *useful_table) {
+    // 统计对子数，4张相同的牌算2对
+    int pair_cnt = tile_set_count(sets.has[1]) + tile_set_count(sets.has[3]);
+
+    // 有效牌，即凑不成对的牌，也就是枚数为奇数的牌
+    if (useful_table != nullptr) {
+        tile_set_to_useful_table(sets.has[0] ^ sets.has[1] ^ sets.has[2] ^ sets.has[3], useful_table);
+    }
+    return 6 - pair_cnt;
+}
+
 // 七对上听数
 int seven_pairs_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table) {
     if (standing_tiles == nullptr || standing_cnt != 13) {
         return std::numeric_limits<int>::max();
     }
 
-    // 对牌的种类进行打表，并统计对子数
-    int pair_cnt = 0;
-    tile_table_t cnt_table = { 0 };
-    for (intptr_t i = 0; i < standing_cnt; ++i) {
-        tile_t tile = standing_tiles[i];
-        ++cnt_table[tile];
-        if (cnt_table[tile] == 2) {
-            ++pair_cnt;
-            cnt_table[tile] = 0;
-        }
-    }
+    // 对牌的种类进行打表
+    tile_table_t cnt_table;
+    map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-    // 有效牌
-    if (useful_table != nullptr) {
-        std::transform(std::begin(cnt_table), std::end(cnt_table), std::begin(*useful_table), [](int n) { return n != 0; });
-    }
-    return 6 - pair_cnt;
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return seven_pairs_shanten_from_sets(sets, useful_table);
 }
 
 // 七对是否听牌
@@ -722,6 +949,21 @@ bool is_seven_pairs_win(const tile_t *standing_tiles, intptr_t standing_cnt, til
 
 //-------------------------------- 十三幺 --------------------------------
 
+// 以牌集合为参数计算十三幺上听数
+static int thirteen_orphans_shanten_from_sets(const count_sets_t &sets, useful_table_t *useful_table) {
+    int cnt = tile_set_count(sets.has[0] & TILE_SET_THIRTEEN_ORPHANS);  // 幺九牌的种类
+    bool has_pair = (sets.has[1] & TILE_SET_THIRTEEN_ORPHANS) != 0;  // 幺九牌对子
+
+    // 有效牌为所有的幺九牌，当有对子时，已有的幺九牌都不需要了
+    if (useful_table != nullptr) {
+        tile_set_to_useful_table(has_pair ? TILE_SET_THIRTEEN_ORPHANS & ~sets.has[0] : TILE_SET_THIRTEEN_ORPHANS, useful_table);
+    }
+
+    // 当有对子时，上听数为：12-幺九牌的种类
+    // 当没有对子时，上听数为：13-幺九牌的种类
+    return has_pair ? 12 - cnt : 13 - cnt;
+}
+
 // 十三幺上听数
 int thirteen_orphans_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table) {
     if (standing_tiles == nullptr || standing_cnt != 13) {
@@ -732,43 +974,9 @@ int thirteen_orphans_shanten(const tile_t *standing_tiles, intptr_t standing_cnt
     tile_table_t cnt_table;
     map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-    bool has_pair = false;
-    int cnt = 0;
-    for (int i = 0; i < 13; ++i) {
-        int n = cnt_table[standard_thirteen_orphans[i]];
-        if (n > 0) {
-            ++cnt;  // 幺九牌的种类
-            if (n > 1) {
-                has_pair = true;  // 幺九牌对子
-            }
-        }
-    }
-
-    // 当有对子时，上听数为：12-幺九牌的种类
-    // 当没有对子时，上听数为：13-幺九牌的种类
-    int ret = has_pair ? 12 - cnt : 13 - cnt;
-
-    if (useful_table != nullptr) {
-        // 先标记所有的幺九牌为有效牌
-        memset(*useful_table, 0, sizeof(*useful_table));
-        std::for_each(std::begin(standard_thirteen_orphans), std::end(standard_thirteen_orphans),
-            [useful_table](tile_t t) {
-            (*useful_table)[t] = true;
-        });
-
-        // 当有对子时，已有的幺九牌都不需要了
-        if (has_pair) {
-            for (int i = 0; i < 13; ++i) {
-                tile_t t = standard_thirteen_orphans[i];
-                int n = cnt_table[t];
-                if (n > 0) {
-                    (*useful_table)[t] = false;
-                }
-            }
-        }
-    }
-
-    return ret;
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return thirteen_orphans_shanten_from_sets(sets, useful_table);
 }
 
 // 十三幺是否听牌
@@ -795,27 +1003,27 @@ bool is_thirteen_orphans_win(const tile_t *standing_tiles, intptr_t standing_cnt
 
 //-------------------------------- “组合龙+面子+雀头”和型 --------------------------------
 
+// 从计数中剔除牌集合中的牌各一张
+static void remove_tile_set(tile_counts_t *counts, tile_set_t set) {
+    for (; set != 0; set &= set - 1) {
+        tile_counts_remove(counts, tile_set_first(set));
+    }
+}
+
 // 以表格为参数计算组合龙是否听牌
-static bool is_knitted_straight_wait_from_table(const tile_table_t &cnt_table, intptr_t left_cnt, useful_table_t *waiting_table) {
+static bool is_knitted_straight_wait_from_table(const tile_table_t &cnt_table, const count_sets_t &sets, useful_table_t *waiting_table) {
     // 匹配组合龙
-    const tile_t (*matched_seq)[9] = nullptr;
-    tile_t missing_tiles[9];
-    int missing_cnt = 0;
+    tile_set_t matched_set = 0;
+    tile_set_t missing_set = 0;
     for (int i = 0; i < 6; ++i) {  // 逐个组合龙测试
-        missing_cnt = 0;
-        for (int k = 0; k < 9; ++k) {
-            tile_t t = standard_knitted_straight[i][k];
-            if (cnt_table[t] == 0) {  // 缺失的
-                missing_tiles[missing_cnt++] = t;
-            }
-        }
-        if (missing_cnt < 2) {  // 缺2张或以上的肯定没听
-            matched_seq = &standard_knitted_straight[i];
+        missing_set = knitted_straight_sets[i] & ~sets.has[0];
+        if (tile_set_count(missing_set) < 2) {  // 缺2张或以上的肯定没听
+            matched_set = knitted_straight_sets[i];
             break;
         }
     }
 
-    if (matched_seq == nullptr || missing_cnt > 2) {
+    if (matched_set == 0) {
         return false;
     }
 
@@ -824,82 +1032,145 @@ static bool is_knitted_straight_wait_from_table(const tile_table_t &cnt_table, i
     }
 
     // 剔除组合龙
-    tile_table_t temp_table;
-    memcpy(&temp_table, &cnt_table, sizeof(temp_table));
-    for (int i = 0; i < 9; ++i) {
-        tile_t t = (*matched_seq)[i];
-        if (temp_table[t]) {
-            --temp_table[t];
-        }
+    tile_counts_t counts;
+    if (!table_to_tile_counts(cnt_table, &counts)) {
+        return false;
     }
+    remove_tile_set(&counts, matched_set & sets.has[0]);
 
-    if (missing_cnt == 1) {  // 如果缺一张，那么除去组合龙之后的牌应该是完成状态才能听牌
-        if (left_cnt == 10) {
-            if (is_basic_form_win_recursively(temp_table, 2)) {
-                if (waiting_table != nullptr) {  // 获取听牌张，听组合龙缺的一张
-                    (*waiting_table)[missing_tiles[0]] = true;
-                }
-                return true;
-            }
-        }
-        else {
-            if (is_basic_form_win_recursively(temp_table, 5)) {
-                if (waiting_table != nullptr) {  // 获取听牌张，听组合龙缺的一张
-                    (*waiting_table)[missing_tiles[0]] = true;
-                }
-                return true;
+    if (missing_set != 0) {  // 如果缺一张，那么除去组合龙之后的牌应该是完成状态才能听牌
+        if (is_basic_form_win_from_counts(counts)) {
+            if (waiting_table != nullptr) {  // 获取听牌张，听组合龙缺的一张
+                (*waiting_table)[tile_set_first(missing_set)] = true;
             }
+            return true;
         }
     }
-    else if (missing_cnt == 0) {  // 如果组合龙齐了，那么除去组合龙之后的牌要能听，整手牌才能听
-        if (left_cnt == 10) {
-            return is_basic_form_wait_1(temp_table, waiting_table);
-        }
-        else {
-            return is_basic_form_wait_recursively(temp_table, 4, waiting_table);
-        }
+    else {  // 如果组合龙齐了，那么除去组合龙之后的牌要能听，整手牌才能听
+        return is_basic_form_wait_from_counts(counts, waiting_table);
     }
 
     return false;
 }
 
-// 基本和型包含主番的上听数，可用于计算三步高 三同顺 龙等三组面子的番种整个立牌的上听数
-static int basic_form_shanten_specified(const tile_table_t &cnt_table, const tile_t *main_tiles, int main_cnt,
-    intptr_t fixed_cnt, useful_table_t *useful_table) {
+// 各门花色之外其余3门花色的合并结果
+static void merge_other_shapes(const shape_t (&shapes)[4], shape_t (&others)[4]) {
+    // prefix[i]为前i门花色的合并结果，suffix[i]为第i门及之后花色的合并结果
+    shape_t prefix[5], suffix[5];
+    empty_shape(&prefix[0]);
+    empty_shape(&suffix[4]);
+    for (int i = 0; i < 4; ++i) {
+        merge_shape(prefix[i], shapes[i], &prefix[i + 1]);
+        merge_shape(suffix[4 - i], shapes[3 - i], &suffix[3 - i]);
+    }
+    for (int i = 0; i < 4; ++i) {
+        merge_shape(prefix[i], suffix[i + 1], &others[i]);
+    }
+}
 
-    tile_table_t temp_table;
-    memcpy(&temp_table, &cnt_table, sizeof(temp_table));
-    int exist_cnt = 0;
+// 以表格为参数计算组合龙上听数
+// 组合龙在每门数牌中只占147、258、369之一，所以剔除组合龙之后的余牌按花色只有3*3种，字牌则不受影响
+// 先把这9种余牌形状查出来，6种组合龙共享之，再按组合龙缺少的张数从少到多计算，余牌上听数至少为-1，据此剪枝
+static int knitted_straight_shanten_from_table(const tile_table_t &cnt_table, const count_sets_t &sets, intptr_t standing_cnt,
+    useful_table_t *useful_table) {
+    const shape_table_t &table = get_shape_table();
+    const intptr_t fixed_cnt = (13 - standing_cnt) / 3 + 3;  // 组合龙算3组面子
+
+    // 各门数牌剔除147、258、369之后的花色键与形状，以及字牌的花色键与形状
+    suit_key_t residual_keys[3][3], honors_key;
+    shape_t residual_shapes[3][3], honors_shape;
+    for (int k = 0; k < 3; ++k) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + k);
+        suit_key_t key;
+        if (!make_suit_key(cnt_table, suit, &key)) {
+            return std::numeric_limits<int>::max();
+        }
+        for (int p = 0; p < 3; ++p) {
+            residual_keys[k][p] = key;
+            for (int r = p; r < 9; r += 3) {
+                if (cnt_table[make_tile(suit, static_cast<rank_t>(r + 1))] > 0) {
+                    residual_keys[k][p] -= pow5_table[r];
+                }
+            }
+            lookup_shape(table, suit, residual_keys[k][p], &residual_shapes[k][p]);
+        }
+    }
+    if (!make_suit_key(cnt_table, TILE_SUIT_HONORS, &honors_key)) {
+        return std::numeric_limits<int>::max();
+    }
+    lookup_shape(table, TILE_SUIT_HONORS, honors_key, &honors_shape);
+
+    // 第3门数牌与字牌合并，只有3种
+    shape_t tail_shapes[3];
+    for (int p = 0; p < 3; ++p) {
+        merge_shape(residual_shapes[2][p], honors_shape, &tail_shapes[p]);
+    }
 
-    // 统计主番的牌
-    for (int i = 0; i < main_cnt; ++i) {
-        tile_t t = main_tiles[i];
-        int n = cnt_table[t];
-        if (n > 0) {  // 有，削减之
-            ++exist_cnt;
-            --temp_table[t];
+    // 6种组合龙各门数牌分别是147、258、369中的哪个，以及缺少的张数，按缺少的张数从少到多排序
+    int patterns[6][3], missing_cnt[6], order[6];
+    for (int i = 0; i < 6; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            patterns[i][k] = (tile_get_rank(standard_knitted_straight[i][k * 3]) - 1) % 3;
         }
+        missing_cnt[i] = tile_set_count(knitted_straight_sets[i] & ~sets.has[0]);
+        order[i] = i;
     }
+    std::sort(std::begin(order), std::end(order), [&missing_cnt](int a, int b) { return missing_cnt[a] < missing_cnt[b]; });
 
-    // 记录有效牌
-    if (useful_table != nullptr) {
-        memset(*useful_table, 0, sizeof(*useful_table));
+    // 上听数=组合龙缺少的张数+余牌的上听数
+    int ret = std::numeric_limits<int>::max();
+    int shanten[6];
+    std::fill(std::begin(shanten), std::end(shanten), std::numeric_limits<int>::max());
+    for (int j = 0; j < 6; ++j) {
+        const int i = order[j];
+
+        // 需要获取有效牌时，上听数相等的组合龙要合并有效牌，所以只剪掉更大的
+        int lower_bound = missing_cnt[i] - 1;
+        if (useful_table != nullptr ? lower_bound > ret : lower_bound >= ret) {
+            break;
+        }
 
-        // 统计主番缺失的牌
-        for (int i = 0; i < main_cnt; ++i) {
-            tile_t t = main_tiles[i];
-            int n = cnt_table[t];
-            if (n <= 0) {
-                (*useful_table)[t] = true;
-            }
+        shape_t shape;
+        merge_shape(residual_shapes[0][patterns[i][0]], residual_shapes[1][patterns[i][1]], &shape);
+        shanten[i] = missing_cnt[i] + merged_shape_shanten(shape, tail_shapes[patterns[i][2]], fixed_cnt);
+        if (shanten[i] < ret) {
+            ret = shanten[i];
         }
     }
 
-    // 余下牌的上听数
-    int result = basic_form_shanten_from_table(temp_table, fixed_cnt + main_cnt / 3, useful_table);
+    if (useful_table == nullptr) {
+        return ret;
+    }
 
-    // 上听数=主番缺少的张数+余下牌的上听数
-    return (main_cnt - exist_cnt) + result;
+    // 上听数最小的组合龙，有效牌为组合龙缺失的牌与余牌的有效牌，多种组合龙上听数相等的话，直接合并有效牌
+    memset(*useful_table, 0, sizeof(*useful_table));
+    tile_counts_t counts;
+    table_to_tile_counts(cnt_table, &counts);  // 前面已经检查过每种牌不超过4枚
+    for (int i = 0; i < 6; ++i) {
+        if (shanten[i] != ret) {
+            continue;
+        }
+
+        tile_set_t missing_set = knitted_straight_sets[i] & ~sets.has[0];
+        for (tile_set_t set = missing_set; set != 0; set &= set - 1) {
+            (*useful_table)[tile_set_first(set)] = true;
+        }
+
+        // 余牌
+        tile_counts_t temp_counts = counts;
+        remove_tile_set(&temp_counts, knitted_straight_sets[i] & sets.has[0]);
+
+        suit_key_t keys[4] = { residual_keys[0][patterns[i][0]], residual_keys[1][patterns[i][1]], residual_keys[2][patterns[i][2]], honors_key };
+        shape_t shapes[4], others[4];
+        memcpy(&shapes[0], &residual_shapes[0][patterns[i][0]], sizeof(shape_t));
+        memcpy(&shapes[1], &residual_shapes[1][patterns[i][1]], sizeof(shape_t));
+        memcpy(&shapes[2], &residual_shapes[2][patterns[i][2]], sizeof(shape_t));
+        memcpy(&shapes[3], &honors_shape, sizeof(shape_t));
+        merge_other_shapes(shapes, others);
+        basic_form_useful_from_shapes(temp_counts, keys, others, fixed_cnt, ret - missing_cnt[i], useful_table);
+    }
+
+    return ret;
 }
 
 // 组合龙上听数
@@ -912,40 +1183,9 @@ int knitted_straight_shanten(const tile_t *standing_tiles, intptr_t standing_cnt
     tile_table_t cnt_table;
     map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-    int ret = std::numeric_limits<int>::max();
-
-    // 需要获取有效牌时，计算上听数的同时就获取有效牌了
-    if (useful_table != nullptr) {
-        memset(*useful_table, 0, sizeof(*useful_table));
-
-        useful_table_t temp_table;
-
-        // 6种组合龙分别计算
-        for (int i = 0; i < 6; ++i) {
-            int fixed_cnt = (13 - static_cast<int>(standing_cnt)) / 3;
-            int st = basic_form_shanten_specified(cnt_table, standard_knitted_straight[i], 9, fixed_cnt, &temp_table);
-            if (st < ret) {  // 上听数小的，直接覆盖数据
-                ret = st;
-                memcpy(*useful_table, temp_table, sizeof(*useful_table));  // 直接覆盖原来的有效牌数据
-            }
-            else if (st == ret) {  // 两种不同组合龙上听数如果相等的话，直接合并有效牌
-                std::transform(std::begin(*useful_table), std::end(*useful_table), std::begin(temp_table),
-                    std::begin(*useful_table), [](bool u, bool t) { return u || t; });
-            }
-        }
-    }
-    else {
-        // 6种组合龙分别计算
-        for (int i = 0; i < 6; ++i) {
-            int fixed_cnt = (13 - static_cast<int>(standing_cnt)) / 3;
-            int st = basic_form_shanten_specified(cnt_table, standard_knitted_straight[i], 9, fixed_cnt, nullptr);
-            if (st < ret) {
-                ret = st;
-            }
-        }
-    }
-
-    return ret;
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return knitted_straight_shanten_from_table(cnt_table, sets, standing_cnt, useful_table);
 }
 
 // 组合龙是否听牌
@@ -958,7 +1198,9 @@ bool is_knitted_straight_wait(const tile_t *standing_tiles, intptr_t standing_cn
     tile_table_t cnt_table;
     map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-    return is_knitted_straight_wait_from_table(cnt_table, standing_cnt, waiting_table);
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return is_knitted_straight_wait_from_table(cnt_table, sets, waiting_table);
 }
 
 // 组合龙是否和牌
@@ -970,96 +1212,45 @@ bool is_knitted_straight_win(const tile_t *standing_tiles, intptr_t standing_cnt
 
 //-------------------------------- 全不靠/七星不靠 --------------------------------
 
-// 1种组合龙的全不靠上听数
-static int honors_and_knitted_tiles_shanten_1(const tile_t *standing_tiles, intptr_t standing_cnt, int which_seq, useful_table_t *useful_table) {
-    if (standing_tiles == nullptr || standing_cnt != 13) {
-        return std::numeric_limits<int>::max();
-    }
-
-    // 对牌的种类进行打表
-    tile_table_t cnt_table;
-    map_tiles(standing_tiles, standing_cnt, &cnt_table);
+// 以牌集合为参数计算全不靠上听数
+static int honors_and_knitted_tiles_shanten_from_sets(const count_sets_t &sets, useful_table_t *useful_table) {
+    int ret = std::numeric_limits<int>::max();
+    tile_set_t useful_set = 0;
 
-    int cnt = 0;
+    // 6种组合龙分别计算，符合牌型的为组合龙部分的数牌与字牌
+    for (int i = 0; i < 6; ++i) {
+        tile_set_t matched_set = knitted_straight_sets[i] | TILE_SET_HONORS;
 
-    // 统计组合龙部分的数牌
-    for (int i = 0; i < 9; ++i) {
-        tile_t t = standard_knitted_straight[which_seq][i];
-        int n = cnt_table[t];
-        if (n > 0) {  // 有，增加计数
-            ++cnt;
+        // 上听数=13-符合牌型的计数
+        int st = 13 - tile_set_count(sets.has[0] & matched_set);
+        if (st < ret) {  // 上听数小的，直接覆盖有效牌
+            ret = st;
+            useful_set = matched_set & ~sets.has[0];
         }
-    }
-
-    // 统计字牌
-    for (int i = 6; i < 13; ++i) {
-        tile_t t = standard_thirteen_orphans[i];
-        int n = cnt_table[t];
-        if (n > 0) {  // 有，增加计数
-            ++cnt;
+        else if (st == ret) {  // 两种不同组合龙上听数如果相等的话，直接合并有效牌
+            useful_set |= matched_set & ~sets.has[0];
         }
     }
 
-    // 记录有效牌
     if (useful_table != nullptr) {
-        memset(*useful_table, 0, sizeof(*useful_table));
-
-        // 统计组合龙部分缺失的数牌
-        for (int i = 0; i < 9; ++i) {
-            tile_t t = standard_knitted_straight[which_seq][i];
-            int n = cnt_table[t];
-            if (n <= 0) {
-                (*useful_table)[t] = true;
-            }
-        }
-
-        // 统计缺失的字牌
-        for (int i = 6; i < 13; ++i) {
-            tile_t t = standard_thirteen_orphans[i];
-            int n = cnt_table[t];
-            if (n <= 0) {
-                (*useful_table)[t] = true;
-            }
-        }
+        tile_set_to_useful_table(useful_set, useful_table);
     }
-
-    // 上听数=13-符合牌型的计数
-    return 13 - cnt;
+    return ret;
 }
 
 // 全不靠上听数
 int honors_and_knitted_tiles_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table) {
-    int ret = std::numeric_limits<int>::max();
-
-    // 需要获取有效牌时，计算上听数的同时就获取有效牌了
-    if (useful_table != nullptr) {
-        memset(*useful_table, 0, sizeof(*useful_table));
+    if (standing_tiles == nullptr || standing_cnt != 13) {
+        return std::numeric_limits<int>::max();
+    }
 
-        useful_table_t temp_table;
+    // 对牌的种类进行打表
+    tile_table_t cnt_table;
+    map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-        // 6种组合龙分别计算
-        for (int i = 0; i < 6; ++i) {
-            int st = honors_and_knitted_tiles_shanten_1(standing_tiles, standing_cnt, i, &temp_table);
-            if (st < ret) {  // 上听数小的，直接覆盖数据
-                ret = st;
-                memcpy(*useful_table, temp_table, sizeof(*useful_table));  // 直接覆盖原来的有效牌数据
-            }
-            else if (st == ret) {  // 两种不同组合龙上听数如果相等的话，直接合并有效牌
-                std::transform(std::begin(*useful_table), std::end(*useful_table), std::begin(temp_table),
-                    std::begin(*useful_table), [](bool u, bool t) { return u || t; });
-            }
-        }
-    }
-    else {
-        // 6种组合龙分别计算
-        for (int i = 0; i < 6; ++i) {
-            int st = honors_and_knitted_tiles_shanten_1(standing_tiles, standing_cnt, i, nullptr);
-            if (st < ret) {
-                ret = st;
-            }
-        }
-    }
-    return ret;
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return honors_and_knitted_tiles_shanten_from_sets(sets, useful_table);
 }
 
 // 全不靠是否听牌
@@ -1117,16 +1308,15 @@ bool is_waiting(const hand_tiles_t &hand_tiles, useful_table_t *useful_table) {
     }
 
     if (useful_table != nullptr) {
-        if (spcial_waiting && basic_waiting) {
-            std::transform(std::begin(table_special), std::end(table_special), std::begin(table_basic), std::begin(*useful_table),
-                [](bool a, bool b) { return a || b; });
-        }
-        else if (basic_waiting) {
-            memcpy(*useful_table, table_basic, sizeof(table_basic));
+        // 合并听牌
+        tile_set_t set = 0;
+        if (spcial_waiting) {
+            set = tile_set_union(set, useful_table_to_tile_set(table_special));
         }
-        else if (spcial_waiting) {
-            memcpy(*useful_table, table_special, sizeof(table_special));
+        if (basic_waiting) {
+            set = tile_set_union(set, useful_table_to_tile_set(table_basic));
         }
+        tile_set_to_useful_table(set, useful_table);
     }
 
     return (spcial_waiting || basic_waiting);
@@ -1134,113 +1324,390 @@ bool is_waiting(const hand_tiles_t &hand_tiles, useful_table_t *useful_table) {
 
 //-------------------------------- 枚举打牌 --------------------------------
 
-// 枚举打哪张牌1次
-static bool enum_discard_tile_1(const hand_tiles_t *hand_tiles, tile_t discard_tile, uint8_t form_flag,
-    void *context, enum_callback_t enum_callback) {
-    enum_result_t result;
-    result.discard_tile = discard_tile;
-    result.form_flag = FORM_FLAG_BASIC_FORM;
-    result.shanten = basic_form_shanten(hand_tiles->standing_tiles, hand_tiles->tile_count, &result.useful_table);
-    if (result.shanten == 0 && result.useful_table[discard_tile]) {  // 0上听，并且打出的牌是有效牌，则修正为和了
-        result.shanten = -1;
-    }
-    if (!enum_callback(context, &result)) {
-        return false;
+// 0上听，并且打出的牌是有效牌，则修正为和了
+static FORCE_INLINE void adjust_discard_result(enum_result_t *result) {
+    if (result->shanten == 0 && result->useful_table[result->discard_tile]) {
+        result->shanten = -1;
     }
+}
+
+// 以表格及牌集合为参数计算打一张牌之后的特殊和型，依次写入结果，返回写入的数量
+static intptr_t evaluate_discard_special_forms(const tile_table_t &cnt_table, const count_sets_t &sets, intptr_t standing_cnt,
+    tile_t discard_tile, uint8_t form_flag, enum_result_t *results) {
+    intptr_t cnt = 0;
 
     // 立牌有13张时，才需要计算特殊和型
-    if (hand_tiles->tile_count == 13) {
-        if (form_flag | FORM_FLAG_SEVEN_PAIRS) {
-            result.form_flag = FORM_FLAG_SEVEN_PAIRS;
-            result.shanten = seven_pairs_shanten(hand_tiles->standing_tiles, hand_tiles->tile_count, &result.useful_table);
-            if (result.shanten == 0 && result.useful_table[discard_tile]) {  // 0上听，并且打出的牌是有效牌，则修正为和了
-                result.shanten = -1;
-            }
-            if (!enum_callback(context, &result)) {
-                return false;
-            }
+    if (standing_cnt == 13) {
+        if (form_flag & FORM_FLAG_SEVEN_PAIRS) {
+            enum_result_t *result = &results[cnt++];
+            result->discard_tile = discard_tile;
+            result->form_flag = FORM_FLAG_SEVEN_PAIRS;
+            result->shanten = seven_pairs_shanten_from_sets(sets, &result->useful_table);
+            adjust_discard_result(result);
         }
 
-        if (form_flag | FORM_FLAG_THIRTEEN_ORPHANS) {
-            result.form_flag = FORM_FLAG_THIRTEEN_ORPHANS;
-            result.shanten = thirteen_orphans_shanten(hand_tiles->standing_tiles, hand_tiles->tile_count, &result.useful_table);
-            if (result.shanten == 0 && result.useful_table[discard_tile]) {  // 0上听，并且打出的牌是有效牌，则修正为和了
-                result.shanten = -1;
-            }
-            if (!enum_callback(context, &result)) {
-                return false;
-            }
+        if (form_flag & FORM_FLAG_THIRTEEN_ORPHANS) {
+            enum_result_t *result = &results[cnt++];
+            result->discard_tile = discard_tile;
+            result->form_flag = FORM_FLAG_THIRTEEN_ORPHANS;
+            result->shanten = thirteen_orphans_shanten_from_sets(sets, &result->useful_table);
+            adjust_discard_result(result);
         }
 
-        if (form_flag | FORM_FLAG_HONORS_AND_KNITTED_TILES) {
-            result.form_flag = FORM_FLAG_HONORS_AND_KNITTED_TILES;
-            result.shanten = honors_and_knitted_tiles_shanten(hand_tiles->standing_tiles, hand_tiles->tile_count, &result.useful_table);
-            if (result.shanten == 0 && result.useful_table[discard_tile]) {  // 0上听，并且打出的牌是有效牌，则修正为和了
-                result.shanten = -1;
-            }
-            if (!enum_callback(context, &result)) {
-                return false;
-            }
+        if (form_flag & FORM_FLAG_HONORS_AND_KNITTED_TILES) {
+            enum_result_t *result = &results[cnt++];
+            result->discard_tile = discard_tile;
+            result->form_flag = FORM_FLAG_HONORS_AND_KNITTED_TILES;
+            result->shanten = honors_and_knitted_tiles_shanten_from_sets(sets, &result->useful_table);
+            adjust_discard_result(result);
         }
     }
 
     // 立牌有13张或者10张时，才需要计算组合龙
-    if (hand_tiles->tile_count == 13 || hand_tiles->tile_count == 10) {
-        if (form_flag | FORM_FLAG_KNITTED_STRAIGHT) {
-            result.form_flag = FORM_FLAG_KNITTED_STRAIGHT;
-            result.shanten = knitted_straight_shanten(hand_tiles->standing_tiles, hand_tiles->tile_count, &result.useful_table);
-            if (result.shanten == 0 && result.useful_table[discard_tile]) {  // 0上听，并且打出的牌是有效牌，则修正为和了
-                result.shanten = -1;
-            }
-            if (!enum_callback(context, &result)) {
-                return false;
+    if (standing_cnt == 13 || standing_cnt == 10) {
+        if (form_flag & FORM_FLAG_KNITTED_STRAIGHT) {
+            enum_result_t *result = &results[cnt++];
+            result->discard_tile = discard_tile;
+            result->form_flag = FORM_FLAG_KNITTED_STRAIGHT;
+            result->shanten = knitted_straight_shanten_from_table(cnt_table, sets, standing_cnt, &result->useful_table);
+            adjust_discard_result(result);
+        }
+    }
+
+    return cnt;
+}
+
+// 以表格为参数计算打一张牌之后的各和型，依次写入结果，返回写入的数量
+static intptr_t evaluate_discard_from_table(const tile_table_t &cnt_table, intptr_t standing_cnt, tile_t discard_tile,
+    uint8_t form_flag, enum_result_t *results) {
+    intptr_t cnt = 0;
+    if (form_flag & FORM_FLAG_BASIC_FORM) {
+        enum_result_t *result = &results[cnt++];
+        result->discard_tile = discard_tile;
+        result->form_flag = FORM_FLAG_BASIC_FORM;
+        memset(result->useful_table, 0, sizeof(result->useful_table));
+        tile_counts_t counts;
+        result->shanten = table_to_tile_counts(cnt_table, &counts)
+            ? basic_form_shanten_from_counts(counts, (13 - standing_cnt) / 3, &result->useful_table)
+            : std::numeric_limits<int>::max();
+        adjust_discard_result(result);
+    }
+
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+    return cnt + evaluate_discard_special_forms(cnt_table, sets, standing_cnt, discard_tile, form_flag, results + cnt);
+}
+
+// 批量计算打每一张牌的结果
+// 将上牌加入立牌之后，打出的牌只影响其所在的一门花色，其余花色的形状及其合并结果在各种打法之间共享
+intptr_t evaluate_all_discards(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag, enum_result_t *results) {
+    const intptr_t standing_cnt = hand_tiles->tile_count;
+    if (standing_cnt != 13 && standing_cnt != 10 && standing_cnt != 7 && standing_cnt != 4 && standing_cnt != 1) {
+        return 0;
+    }
+
+    // 将立牌打表
+    tile_table_t cnt_table;
+    map_tiles(hand_tiles->standing_tiles, standing_cnt, &cnt_table);
+    if (std::any_of(std::begin(cnt_table), std::end(cnt_table), [](int n) { return n > 4; })) {
+        return 0;
+    }
+
+    // 没有上牌，或者上牌已经有4张时，只计算摸切
+    if (serving_tile == 0 || cnt_table[serving_tile] >= 4) {
+        return evaluate_discard_from_table(cnt_table, standing_cnt, serving_tile, form_flag, results);
+    }
+
+    // 上这张牌
+    ++cnt_table[serving_tile];
+    tile_counts_t counts;
+    table_to_tile_counts(cnt_table, &counts);  // 前面已经检查过每种牌不超过4枚
+
+    const shape_table_t &table = get_shape_table();
+    const intptr_t fixed_cnt = (13 - standing_cnt) / 3;
+
+    // 上牌之后各门花色的花色键与形状
+    suit_key_t keys[4];
+    shape_t shapes[4];
+    for (int i = 0; i < 4; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        make_suit_key(counts, suit, &keys[i]);
+        lookup_shape(table, suit, keys[i], &shapes[i]);
+    }
+
+    // others[i]为第i门花色之外其余3门花色的合并结果
+    // pairs[i][j]为第i、j门花色之外其余2门花色的合并结果
+    shape_t others[4], pairs[4][4];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = i + 1; j < 4; ++j) {
+            int k = 0, l;
+            while (k == i || k == j) ++k;
+            l = 6 - i - j - k;
+            merge_shape(shapes[k], shapes[l], &pairs[i][j]);
+            memcpy(&pairs[j][i], &pairs[i][j], sizeof(shape_t));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        merge_shape(pairs[i][(i + 1) & 3], shapes[(i + 1) & 3], &others[i]);
+    }
+
+    // 上牌之后的牌集合，打出一张牌只改变其中一位
+    count_sets_t sets;
+    make_count_sets(cnt_table, &sets);
+
+    intptr_t cnt = 0;
+
+    // 依次尝试打出各张牌，先计算摸切的，其余只遍历手中有的牌
+    tile_set_t discard_set = sets.has[0] & ~make_tile_set(serving_tile);
+    for (tile_t t = serving_tile; t != 0; t = tile_set_pop_first(&discard_set)) {
+        const int idx = tile_get_suit(t) - TILE_SUIT_CHARACTERS;
+        const int r = tile_get_rank(t) - 1;
+
+        --cnt_table[t];  // 打这张牌
+        tile_counts_remove(&counts, t);
+
+        if (form_flag & FORM_FLAG_BASIC_FORM) {
+            enum_result_t *result = &results[cnt++];
+            result->discard_tile = t;
+            result->form_flag = FORM_FLAG_BASIC_FORM;
+            memset(result->useful_table, 0, sizeof(result->useful_table));
+
+            // 只有打出的牌所在的一门花色需要重新查表
+            suit_key_t temp_keys[4];
+            memcpy(temp_keys, keys, sizeof(temp_keys));
+            temp_keys[idx] -= pow5_table[r];
+            shape_t shape;
+            lookup_shape(table, static_cast<suit_t>(TILE_SUIT_CHARACTERS + idx), temp_keys[idx], &shape);
+            result->shanten = merged_shape_shanten(shape, others[idx], fixed_cnt);
+
+            // 有效牌
+            shape_t temp_others[4];
+            for (int i = 0; i < 4; ++i) {
+                if (i == idx) {
+                    memcpy(&temp_others[i], &others[i], sizeof(shape_t));
+                }
+                else {
+                    merge_shape(shape, pairs[idx][i], &temp_others[i]);
+                }
             }
+            basic_form_useful_from_shapes(counts, temp_keys, temp_others, fixed_cnt, result->shanten, &result->useful_table);
+            adjust_discard_result(result);
         }
+
+        count_sets_t temp_sets;
+        memcpy(&temp_sets, &sets, sizeof(temp_sets));
+        count_sets_remove_tile(&temp_sets, t, cnt_table[t]);
+        cnt += evaluate_discard_special_forms(cnt_table, temp_sets, standing_cnt, t, form_flag, results + cnt);
+
+        ++cnt_table[t];  // 复原
+        tile_counts_add(&counts, t);
     }
 
-    return true;
+    return cnt;
 }
 
 // 枚举打哪张牌
 void enum_discard_tile(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag,
     void *context, enum_callback_t enum_callback) {
-    // 先计算摸切的
-    if (!enum_discard_tile_1(hand_tiles, serving_tile, form_flag, context, enum_callback)) {
-        return;
+    enum_result_t results[MAX_DISCARD_RESULT_CNT];
+    intptr_t cnt = evaluate_all_discards(hand_tiles, serving_tile, form_flag, results);
+    for (intptr_t i = 0; i < cnt; ++i) {
+        if (!enum_callback(context, &results[i])) {
+            return;
+        }
     }
+}
+
+
+//-------------------------------- 增量计算 --------------------------------
+
+// 需要重新计算的花色标记，低4位为基本和型，高4位为组合龙
+#define SHANTEN_STATE_DIRTY_BASIC(idx_) (1U << (idx_))
+#define SHANTEN_STATE_DIRTY_KNITTED(idx_) (0x10U << (idx_))
+#define SHANTEN_STATE_DIRTY_ALL 0xFFU
 
-    if (serving_tile == 0) {
+// 重新计算增量状态中一门花色的拆解结果
+static void shanten_state_update_suit(shanten_state_t *state, int idx, bool knitted) {
+    const shape_table_t &table = get_shape_table();
+    const suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + idx);
+
+    suit_key_t key = 0;
+    make_suit_key(state->cnt_table, suit, &key);  // 增减牌时已经保证了每种牌不超过4张
+
+    if (suit == TILE_SUIT_HONORS) {
+        state->basic_shapes[idx] = table.honors[key];
+        return;
+    }
+    state->basic_shapes[idx] = table.numbered[key];
+    if (!knitted) {
         return;
     }
 
-    // 将立牌打表
-    tile_table_t cnt_table;
-    map_tiles(hand_tiles->standing_tiles, hand_tiles->tile_count, &cnt_table);
+    // 组合龙在一门数牌中只可能是147、258、369之一，分别削减之
+    const uint16_t *cnt = &state->cnt_table[make_tile(suit, 1)];
+    for (int p = 0; p < 3; ++p) {
+        suit_key_t k = key;
+        int kinds = 0;
+        for (int r = p; r < 9; r += 3) {
+            if (cnt[r] > 0) {
+                k -= pow5_table[r];
+                ++kinds;
+            }
+        }
+        state->knitted_shapes[idx][p] = table.numbered[k];
+        state->knitted_kinds[idx][p] = static_cast<uint8_t>(kinds);
+    }
+}
 
-    // 复制一份手牌
-    hand_tiles_t temp;
-    memcpy(&temp, hand_tiles, sizeof(temp));
+// 重新计算增量状态中所有标记过的花色
+static void shanten_state_update(shanten_state_t *state, bool knitted) {
+    for (int i = 0; i < 4; ++i) {
+        uint8_t mask = static_cast<uint8_t>(SHANTEN_STATE_DIRTY_BASIC(i) | (knitted ? SHANTEN_STATE_DIRTY_KNITTED(i) : 0));
+        if (state->dirty_flag & mask) {
+            shanten_state_update_suit(state, i, knitted && i < 3);
+            state->dirty_flag &= static_cast<uint8_t>(~mask);
+        }
+    }
+}
 
-    // 依次尝试打手中的立牌
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] && t != serving_tile && cnt_table[serving_tile] < 4) {
-            --cnt_table[t];  // 打这张牌
-            ++cnt_table[serving_tile];  // 上这张牌
+// 初始化增量计算上听数的状态
+bool shanten_state_init(shanten_state_t *state, const tile_t *standing_tiles, intptr_t standing_cnt) {
+    memset(state, 0, sizeof(*state));
+    state->dirty_flag = SHANTEN_STATE_DIRTY_ALL;
+    for (intptr_t i = 0; i < standing_cnt; ++i) {
+        if (!shanten_state_add_tile(state, standing_tiles[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 增量计算上听数的状态中增加一张牌
+bool shanten_state_add_tile(shanten_state_t *state, tile_t tile) {
+    if (!is_numbered_suit(tile) && !is_honor(tile)) {
+        return false;
+    }
+    uint16_t &n = state->cnt_table[tile];
+    if (n >= 4) {
+        return false;
+    }
+
+    ++n;
+    ++state->tile_count;
+
+    // 七对、十三幺、全不靠只需要统计种类和对子
+    if ((n & 1) == 0) {
+        ++state->pair_cnt;
+    }
+    if (is_terminal_or_honor(tile)) {
+        if (n == 1) ++state->orphan_kinds;
+        else if (n == 2) ++state->orphan_pairs;
+    }
+    if (n == 1 && is_honor(tile)) {
+        ++state->honor_kinds;
+    }
+
+    // 推迟到获取上听数时再计算
+    int idx = tile_get_suit(tile) - TILE_SUIT_CHARACTERS;
+    state->dirty_flag |= static_cast<uint8_t>(SHANTEN_STATE_DIRTY_BASIC(idx) | SHANTEN_STATE_DIRTY_KNITTED(idx));
+    return true;
+}
+
+// 增量计算上听数的状态中减少一张牌
+bool shanten_state_remove_tile(shanten_state_t *state, tile_t tile) {
+    if (!is_numbered_suit(tile) && !is_honor(tile)) {
+        return false;
+    }
+    uint16_t &n = state->cnt_table[tile];
+    if (n == 0) {
+        return false;
+    }
+
+    if ((n & 1) == 0) {
+        --state->pair_cnt;
+    }
+    if (is_terminal_or_honor(tile)) {
+        if (n == 1) --state->orphan_kinds;
+        else if (n == 2) --state->orphan_pairs;
+    }
+    if (n == 1 && is_honor(tile)) {
+        --state->honor_kinds;
+    }
+
+    --n;
+    --state->tile_count;
 
-            // 从table转成立牌
-            table_to_tiles(cnt_table, temp.standing_tiles, temp.tile_count);
+    // 推迟到获取上听数时再计算
+    int idx = tile_get_suit(tile) - TILE_SUIT_CHARACTERS;
+    state->dirty_flag |= static_cast<uint8_t>(SHANTEN_STATE_DIRTY_BASIC(idx) | SHANTEN_STATE_DIRTY_KNITTED(idx));
+    return true;
+}
+
+// 合并4门花色的拆解结果并计算上听数
+static int shanten_state_shapes_shanten(suit_shape_t s0, suit_shape_t s1, suit_shape_t s2, suit_shape_t s3, intptr_t fixed_cnt) {
+    shape_t a, b, ab, c, d, cd;
+    unpack_shape(s0, &a);
+    unpack_shape(s1, &b);
+    unpack_shape(s2, &c);
+    unpack_shape(s3, &d);
+    merge_shape(a, b, &ab);
+    merge_shape(c, d, &cd);
+    return merged_shape_shanten(ab, cd, fixed_cnt);
+}
 
-            // 计算
-            if (!enum_discard_tile_1(&temp, t, form_flag, context, enum_callback)) {
-                return;
+// 由增量计算上听数的状态获取上听数
+int shanten_state_query(shanten_state_t *state, uint8_t form_flag) {
+    const intptr_t standing_cnt = state->tile_count;
+    int ret = std::numeric_limits<int>::max();
+
+    const bool knitted_straight = (form_flag & FORM_FLAG_KNITTED_STRAIGHT) && (standing_cnt == 13 || standing_cnt == 10);
+    const bool honors_and_knitted_tiles = (form_flag & FORM_FLAG_HONORS_AND_KNITTED_TILES) && standing_cnt == 13;
+    shanten_state_update(state, knitted_straight || honors_and_knitted_tiles);
+
+    // 基本和型
+    if ((form_flag & FORM_FLAG_BASIC_FORM) && standing_cnt <= 13 && standing_cnt % 3 == 1) {
+        int st = shanten_state_shapes_shanten(state->basic_shapes[0], state->basic_shapes[1],
+            state->basic_shapes[2], state->basic_shapes[3], (13 - standing_cnt) / 3);
+        ret = std::min(ret, st);
+    }
+
+    // 以下和型只能门清
+    if (standing_cnt == 13) {
+        // 七对
+        if (form_flag & FORM_FLAG_SEVEN_PAIRS) {
+            ret = std::min(ret, 6 - state->pair_cnt);
+        }
+
+        // 十三幺
+        if (form_flag & FORM_FLAG_THIRTEEN_ORPHANS) {
+            ret = std::min(ret, (state->orphan_pairs > 0 ? 12 : 13) - state->orphan_kinds);
+        }
+    }
+
+    // 组合龙与全不靠，6种组合龙分别计算
+    if (knitted_straight || honors_and_knitted_tiles) {
+        for (int i = 0; i < 6; ++i) {
+            // 各门数牌的组合龙是147、258、369中的哪个
+            int p[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = (tile_get_rank(standard_knitted_straight[i][k * 3]) - 1) % 3;
             }
+            int kinds = state->knitted_kinds[0][p[0]] + state->knitted_kinds[1][p[1]] + state->knitted_kinds[2][p[2]];
 
-            // 复原
-            --cnt_table[serving_tile];
-            ++cnt_table[t];
+            if (honors_and_knitted_tiles) {
+                // 上听数=13-符合牌型的计数
+                ret = std::min(ret, 13 - kinds - state->honor_kinds);
+            }
+            if (knitted_straight) {
+                // 上听数=组合龙缺少的张数+余下牌的上听数
+                int st = shanten_state_shapes_shanten(state->knitted_shapes[0][p[0]], state->knitted_shapes[1][p[1]],
+                    state->knitted_shapes[2][p[2]], state->basic_shapes[3], (13 - standing_cnt) / 3 + 3);
+                ret = std::min(ret, (9 - kinds) + st);
+            }
         }
     }
+
+    return ret;
 }
 
 }
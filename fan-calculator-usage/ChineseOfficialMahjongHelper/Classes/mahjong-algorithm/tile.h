@@ -184,6 +184,276 @@ static const tile_t all_tiles[] = {
  */
 typedef uint16_t tile_table_t[TILE_TABLE_SIZE];
 
+/**
+ * @brief 牌集合类型
+ *  每种牌占1位，第i位表示all_tiles[i]，即依次为万子、条子、饼子、字牌
+ *  求并集、交集、计数等操作只需要少量的位运算，适合大量候选之间比较有效牌
+ */
+typedef uint64_t tile_set_t;
+
+/**
+ * @brief 获取牌在all_tiles中的下标
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in] tile 牌
+ * @return int 下标
+ */
+static FORCE_INLINE int tile_get_index(tile_t tile) {
+    return (tile_get_suit(tile) - 1) * 9 + tile_get_rank(tile) - 1;
+}
+
+/**
+ * @brief 生成只含一张牌的牌集合
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in] tile 牌
+ * @return tile_set_t 牌集合
+ */
+static FORCE_INLINE tile_set_t make_tile_set(tile_t tile) {
+    return 1ULL << tile_get_index(tile);
+}
+
+/**
+ * @brief 判断牌集合中是否有某张牌
+ * @param [in] set 牌集合
+ * @param [in] tile 牌
+ * @return bool
+ */
+static FORCE_INLINE bool tile_set_contains(tile_set_t set, tile_t tile) {
+    return (set & make_tile_set(tile)) != 0;
+}
+
+/**
+ * @brief 牌集合的并集
+ * @param [in] set0 牌集合
+ * @param [in] set1 牌集合
+ * @return tile_set_t 并集
+ */
+static FORCE_INLINE tile_set_t tile_set_union(tile_set_t set0, tile_set_t set1) {
+    return set0 | set1;
+}
+
+/**
+ * @brief 牌集合的交集
+ * @param [in] set0 牌集合
+ * @param [in] set1 牌集合
+ * @return tile_set_t 交集
+ */
+static FORCE_INLINE tile_set_t tile_set_intersect(tile_set_t set0, tile_set_t set1) {
+    return set0 & set1;
+}
+
+/**
+ * @brief 牌集合中牌的种类数
+ * @param [in] set 牌集合
+ * @return int 种类数
+ */
+static FORCE_INLINE int tile_set_count(tile_set_t set) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(set);
+#else
+    set = set - ((set >> 1) & 0x5555555555555555ULL);
+    set = (set & 0x3333333333333333ULL) + ((set >> 2) & 0x3333333333333333ULL);
+    set = (set + (set >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((set * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief 牌集合中最小下标的牌
+ *  牌集合不能为空
+ * @param [in] set 牌集合
+ * @return tile_t 牌
+ */
+static FORCE_INLINE tile_t tile_set_first(tile_set_t set) {
+#if defined(__GNUC__) || defined(__clang__)
+    return all_tiles[__builtin_ctzll(set)];
+#else
+    return all_tiles[tile_set_count((set & (~set + 1)) - 1)];
+#endif
+}
+
+/**
+ * @brief 取出牌集合中最小下标的牌
+ *  用于按下标从小到大遍历集合中的牌，只访问集合中有的牌
+ * @param [in,out] set 牌集合，取出的牌从中移除
+ * @return tile_t 牌，集合为空时返回0
+ */
+static FORCE_INLINE tile_t tile_set_pop_first(tile_set_t *set) {
+    if (*set == 0) {
+        return 0;
+    }
+    tile_t tile = tile_set_first(*set);
+    *set &= *set - 1;
+    return tile;
+}
+
+/**
+ * @brief 牌集合中各种牌在牌表中的加权计数
+ *  例如传入剩余牌表，则结果为集合中这些牌的剩余枚数之和
+ * @param [in] set 牌集合
+ * @param [in] weight_table 各种牌的权重
+ * @return int 加权计数
+ */
+static FORCE_INLINE int tile_set_weighted_count(tile_set_t set, const tile_table_t &weight_table) {
+    int cnt = 0;
+    for (; set != 0; set &= set - 1) {
+        cnt += weight_table[tile_set_first(set)];
+    }
+    return cnt;
+}
+
+/**
+ * @brief 紧凑的牌计数
+ *  每种牌的枚数占3位，每门花色占27位（字牌21位），两门花色放在一个64位整数中：
+ *  words[0]的低32位为万子、高32位为条子，words[1]的低32位为饼子、高32位为字牌
+ *  整个计数只有16字节，复制与比较的开销远小于牌表，并且可以用位运算（SWAR）同时处理多种牌
+ *  每种牌最多记录7枚，超出时会进位到相邻的牌
+ */
+struct tile_counts_t {
+    uint64_t words[2];  ///< 各门花色的计数
+};
+
+/**
+ * @brief 计数中各种牌所占3位中的最低位
+ */
+#define TILE_COUNTS_LOW_BITS 0x0124924901249249ULL
+
+/**
+ * @brief 一门花色的计数所占的位
+ */
+#define TILE_COUNTS_SUIT_BITS 0x07FFFFFFU
+
+/**
+ * @brief 判断是否为可以记入计数的牌，即数牌1-9及字牌1-7
+ * @param [in] tile 牌
+ * @return bool
+ */
+static FORCE_INLINE bool is_tile_countable(tile_t tile) {
+    suit_t suit = tile_get_suit(tile);
+    rank_t rank = tile_get_rank(tile);
+    return rank >= 1 && ((suit >= TILE_SUIT_CHARACTERS && suit <= TILE_SUIT_DOTS && rank <= 9) || (suit == TILE_SUIT_HONORS && rank <= 7));
+}
+
+/**
+ * @brief 牌在计数中的位置
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in] tile 牌
+ * @return int 位置，低6位为所在整数中的偏移，第6位为所在整数的下标
+ */
+static FORCE_INLINE int tile_counts_position(tile_t tile) {
+    return ((tile_get_suit(tile) - 1) << 5) + (tile_get_rank(tile) - 1) * 3;
+}
+
+/**
+ * @brief 计数中一种牌的枚数
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in] counts 计数
+ * @param [in] tile 牌
+ * @return int 枚数
+ */
+static FORCE_INLINE int tile_counts_get(const tile_counts_t &counts, tile_t tile) {
+    int pos = tile_counts_position(tile);
+    return static_cast<int>((counts.words[pos >> 6] >> (pos & 63)) & 7);
+}
+
+/**
+ * @brief 计数中增加一张牌
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in,out] counts 计数
+ * @param [in] tile 牌
+ */
+static FORCE_INLINE void tile_counts_add(tile_counts_t *counts, tile_t tile) {
+    int pos = tile_counts_position(tile);
+    counts->words[pos >> 6] += 1ULL << (pos & 63);
+}
+
+/**
+ * @brief 计数中减少一张牌
+ *  函数不检查输入的合法性。如果输入不合法的值，将无法保证合法返回值的合法性
+ * @param [in,out] counts 计数
+ * @param [in] tile 牌
+ */
+static FORCE_INLINE void tile_counts_remove(tile_counts_t *counts, tile_t tile) {
+    int pos = tile_counts_position(tile);
+    counts->words[pos >> 6] -= 1ULL << (pos & 63);
+}
+
+/**
+ * @brief 计数中一门花色的部分
+ *  结果的第3r至3r+2位为点数r+1的枚数，可以直接用作按花色查表的键的来源
+ * @param [in] counts 计数
+ * @param [in] suit 花色
+ * @return uint32_t 这门花色的计数
+ */
+static FORCE_INLINE uint32_t tile_counts_suit(const tile_counts_t &counts, suit_t suit) {
+    int idx = suit - TILE_SUIT_CHARACTERS;
+    return static_cast<uint32_t>(counts.words[idx >> 1] >> ((idx & 1) << 5)) & TILE_COUNTS_SUIT_BITS;
+}
+
+/**
+ * @brief 至少有1枚的牌
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return uint64_t 满足条件的牌所占3位中的最低位置1
+ */
+static FORCE_INLINE uint64_t tile_counts_at_least_1(uint64_t word) {
+    return (word | (word >> 1) | (word >> 2)) & TILE_COUNTS_LOW_BITS;
+}
+
+/**
+ * @brief 至少有2枚的牌
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return uint64_t 满足条件的牌所占3位中的最低位置1
+ */
+static FORCE_INLINE uint64_t tile_counts_at_least_2(uint64_t word) {
+    return ((word >> 1) | (word >> 2)) & TILE_COUNTS_LOW_BITS;
+}
+
+/**
+ * @brief 至少有3枚的牌
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return uint64_t 满足条件的牌所占3位中的最低位置1
+ */
+static FORCE_INLINE uint64_t tile_counts_at_least_3(uint64_t word) {
+    return ((word >> 2) | (word & (word >> 1))) & TILE_COUNTS_LOW_BITS;
+}
+
+/**
+ * @brief 至少有4枚的牌
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return uint64_t 满足条件的牌所占3位中的最低位置1
+ */
+static FORCE_INLINE uint64_t tile_counts_at_least_4(uint64_t word) {
+    return (word >> 2) & TILE_COUNTS_LOW_BITS;
+}
+
+/**
+ * @brief 超过4枚的牌
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return uint64_t 满足条件的牌所占3位中的最低位置1
+ */
+static FORCE_INLINE uint64_t tile_counts_more_than_4(uint64_t word) {
+    return (word >> 2) & (word | (word >> 1)) & TILE_COUNTS_LOW_BITS;
+}
+
+/**
+ * @brief 计数中的总张数
+ * @param [in] word 计数中的一个整数或一门花色
+ * @return int 张数
+ */
+static FORCE_INLINE int tile_counts_sum(uint64_t word) {
+    return tile_set_count(word & TILE_COUNTS_LOW_BITS) + 2 * tile_set_count(word & (TILE_COUNTS_LOW_BITS << 1))
+        + 4 * tile_set_count(word & (TILE_COUNTS_LOW_BITS << 2));
+}
+
+/**
+ * @brief 计数中的对子数，4枚相同的牌算2对
+ * @param [in] counts 计数
+ * @return int 对子数
+ */
+static FORCE_INLINE int tile_counts_pair_count(const tile_counts_t &counts) {
+    return tile_set_count(tile_counts_at_least_2(counts.words[0])) + tile_set_count(tile_counts_at_least_4(counts.words[0]))
+        + tile_set_count(tile_counts_at_least_2(counts.words[1])) + tile_set_count(tile_counts_at_least_4(counts.words[1]));
+}
+
 #define PACK_TYPE_NONE 0  ///< 无效
 #define PACK_TYPE_CHOW 1  ///< 顺子
 #define PACK_TYPE_PUNG 2  ///< 刻子
@@ -2,24 +2,22 @@
 #include "shanten.h"
 #include "stringify.h"
 #include "fan_calculator.h"
+#include "cache.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <limits>
+#include <algorithm>
 #include <assert.h>
 #include <time.h>
 
 using namespace mahjong;
 
 static int count_useful_tile(const tile_table_t &used_table, const useful_table_t &useful_table) {
-    int cnt = 0;
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (useful_table[t]) {
-            cnt += 4 - used_table[t];
-        }
-    }
-    return cnt;
+    // 每种有效牌4枚，减去已经用掉的
+    tile_set_t useful_set = useful_table_to_tile_set(useful_table);
+    return 4 * tile_set_count(useful_set) - tile_set_weighted_count(useful_set, used_table);
 }
 
 void test_wait(const char *str) {
@@ -142,6 +140,303 @@ void test_shanten(const char *str) {
     puts("\n");
 }
 
+void test_shanten_state(const char *str, tile_t draw_tile, tile_t discard_tile) {
+    hand_tiles_t hand_tiles;
+    tile_t serving_tile;
+    long ret = string_to_tiles(str, &hand_tiles, &serving_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    puts(str);
+    shanten_state_t state;
+    if (!shanten_state_init(&state, hand_tiles.standing_tiles, hand_tiles.tile_count)) {
+        printf("error at line %d\n", __LINE__);
+        return;
+    }
+
+    // 摸一张打一张之后，与重新计算的结果比较
+    shanten_state_add_tile(&state, draw_tile);
+    shanten_state_remove_tile(&state, discard_tile);
+    tile_t *it = std::find(hand_tiles.standing_tiles, hand_tiles.standing_tiles + hand_tiles.tile_count, discard_tile);
+    if (it != hand_tiles.standing_tiles + hand_tiles.tile_count) {
+        *it = draw_tile;
+    }
+
+    const tile_t *tiles = hand_tiles.standing_tiles;
+    intptr_t cnt = hand_tiles.tile_count;
+    int expected[5] = {
+        basic_form_shanten(tiles, cnt, nullptr),
+        seven_pairs_shanten(tiles, cnt, nullptr),
+        thirteen_orphans_shanten(tiles, cnt, nullptr),
+        honors_and_knitted_tiles_shanten(tiles, cnt, nullptr),
+        knitted_straight_shanten(tiles, cnt, nullptr)
+    };
+    for (int i = 0; i < 5; ++i) {
+        int st = shanten_state_query(&state, static_cast<uint8_t>(1 << i));
+        printf("form %d: %d shanten %s\n", 1 << i, st, st == expected[i] ? "OK" : "FAILED");
+    }
+    puts("");
+}
+
+void test_tile_counts() {
+    bool ok = true;
+    auto expect = [&ok](bool cond, int line) {
+        if (!cond && ok) {
+            printf("error at line %d\n", line);
+            ok = false;
+        }
+    };
+
+    // 花色交界处的牌：9m与1s分别在words[0]的两半，9p与东分别在words[1]的两半，白在最高位
+    static const tile_t tiles[] = { TILE_1m, TILE_9m, TILE_1s, TILE_9s, TILE_1p, TILE_9p, TILE_E, TILE_P };
+    const int kinds = sizeof(tiles) / sizeof(tiles[0]);
+
+    // 每种牌分别取0-4枚，遍历所有组合
+    int total = 1;
+    for (int i = 0; i < kinds; ++i) {
+        total *= 5;
+    }
+    for (int n = 0; n < total && ok; ++n) {
+        int cnts[kinds];
+        tile_table_t cnt_table = { 0 };
+        tile_t list[4 * kinds];
+        intptr_t list_cnt = 0;
+        tile_counts_t counts = { { 0, 0 } };
+        int pairs = 0;
+        for (int i = 0, v = n; i < kinds; ++i, v /= 5) {
+            cnts[i] = v % 5;
+            cnt_table[tiles[i]] = cnts[i];
+            for (int k = 0; k < cnts[i]; ++k) {
+                list[list_cnt++] = tiles[i];
+                tile_counts_add(&counts, tiles[i]);
+            }
+            pairs += (cnts[i] >= 2) + (cnts[i] == 4);
+        }
+
+        tile_counts_t temp;
+        expect(map_tile_counts(list, list_cnt, &temp) && memcmp(&temp, &counts, sizeof(counts)) == 0, __LINE__);
+        expect(table_to_tile_counts(cnt_table, &temp) && memcmp(&temp, &counts, sizeof(counts)) == 0, __LINE__);
+        expect(tile_counts_pair_count(counts) == pairs, __LINE__);
+        expect(tile_counts_sum(counts.words[0]) + tile_counts_sum(counts.words[1]) == list_cnt, __LINE__);
+        expect(tile_counts_more_than_4(counts.words[0]) == 0 && tile_counts_more_than_4(counts.words[1]) == 0, __LINE__);
+
+        for (int i = 0; i < kinds; ++i) {
+            const tile_t t = tiles[i];
+            const int pos = tile_counts_position(t);
+            const uint64_t word = counts.words[pos >> 6];
+            const int bit = pos & 63;
+            expect(tile_counts_get(counts, t) == cnts[i], __LINE__);
+            expect(((tile_counts_suit(counts, tile_get_suit(t)) >> ((tile_get_rank(t) - 1) * 3)) & 7) == static_cast<uint32_t>(cnts[i]), __LINE__);
+            expect(((tile_counts_at_least_1(word) >> bit) & 1) == (cnts[i] >= 1), __LINE__);
+            expect(((tile_counts_at_least_2(word) >> bit) & 1) == (cnts[i] >= 2), __LINE__);
+            expect(((tile_counts_at_least_3(word) >> bit) & 1) == (cnts[i] >= 3), __LINE__);
+            expect(((tile_counts_at_least_4(word) >> bit) & 1) == (cnts[i] >= 4), __LINE__);
+        }
+
+        // 逐张减掉，应该回到空的计数
+        for (intptr_t i = 0; i < list_cnt; ++i) {
+            tile_counts_remove(&counts, list[i]);
+        }
+        expect(counts.words[0] == 0 && counts.words[1] == 0, __LINE__);
+    }
+
+    // 超过4枚
+    for (int i = 0; i < kinds; ++i) {
+        const tile_t t = tiles[i];
+        const int pos = tile_counts_position(t);
+        for (int c = 5; c <= 7; ++c) {
+            tile_table_t cnt_table = { 0 };
+            cnt_table[t] = c;
+            tile_counts_t counts;
+            expect(table_to_tile_counts(cnt_table, &counts), __LINE__);
+            expect(((tile_counts_more_than_4(counts.words[pos >> 6]) >> (pos & 63)) & 1) == 1, __LINE__);
+            expect(tile_counts_get(counts, t) == c, __LINE__);
+        }
+
+        // 8枚无法记录
+        tile_t list[8];
+        std::fill(std::begin(list), std::end(list), t);
+        tile_counts_t counts;
+        expect(!map_tile_counts(list, 8, &counts), __LINE__);
+        tile_table_t cnt_table = { 0 };
+        cnt_table[t] = 8;
+        expect(!table_to_tile_counts(cnt_table, &counts), __LINE__);
+    }
+
+    printf("tile_counts: %s\n", ok ? "OK" : "FAILED");
+}
+
+void test_discards(const char *str, uint8_t form_flag) {
+    hand_tiles_t hand_tiles;
+    tile_t serving_tile;
+    long ret = string_to_tiles(str, &hand_tiles, &serving_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    puts(str);
+    tile_table_t cnt_table;
+    map_hand_tiles(&hand_tiles, &cnt_table);
+    ++cnt_table[serving_tile];
+
+    enum_result_t results[MAX_DISCARD_RESULT_CNT];
+    intptr_t cnt = evaluate_all_discards(&hand_tiles, serving_tile, form_flag, results);
+    for (intptr_t i = 0; i < cnt; ++i) {
+        char buf[64];
+        tiles_to_string(&results[i].discard_tile, 1, buf, sizeof(buf));
+        printf("discard %s form %d: %d shanten, %d枚\n", buf, results[i].form_flag, results[i].shanten,
+            count_useful_tile(cnt_table, results[i].useful_table));
+    }
+    puts("");
+}
+
+void test_fan_for_waits(const char *str, win_flag_t win_flag) {
+    calculate_param_t param;
+    memset(&param, 0, sizeof(param));
+    long ret = string_to_tiles(str, &param.hand_tiles, &param.win_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    puts(str);
+    param.win_flag = win_flag;
+    param.prevalent_wind = wind_t::EAST;
+    param.seat_wind = wind_t::EAST;
+
+    wait_fan_t results[34];
+    intptr_t cnt = calculate_fan_for_waits(&param, results);
+    for (intptr_t i = 0; i < cnt; ++i) {
+        // 与逐张调用calculate_fan的结果比较
+        fan_table_t fan_table;
+        param.win_tile = results[i].win_tile;
+        int fan = calculate_fan(&param, &fan_table);
+
+        char buf[64];
+        tiles_to_string(&results[i].win_tile, 1, buf, sizeof(buf));
+        printf("win %s: %d fan %s\n", buf, results[i].fan,
+            (fan == results[i].fan && memcmp(fan_table, results[i].fan_table, sizeof(fan_table)) == 0) ? "OK" : "FAILED");
+    }
+    puts("");
+}
+
+void test_fan_threshold(const char *str, win_flag_t win_flag, int min_fan) {
+    calculate_param_t param;
+    memset(&param, 0, sizeof(param));
+    long ret = string_to_tiles(str, &param.hand_tiles, &param.win_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    param.win_flag = win_flag;
+    param.prevalent_wind = wind_t::EAST;
+    param.seat_wind = wind_t::EAST;
+
+    // 与完整算番的结果比较
+    fan_table_t fan_table;
+    int fan = calculate_fan(&param, &fan_table);
+    bool meets = meets_fan_threshold(&param, min_fan);
+    printf("%s >= %d: %s %s\n", str, min_fan, meets ? "true" : "false", (meets == (fan >= min_fan)) ? "OK" : "FAILED");
+}
+
+void test_fan_result(const char *str, win_flag_t win_flag) {
+    calculate_param_t param;
+    memset(&param, 0, sizeof(param));
+    long ret = string_to_tiles(str, &param.hand_tiles, &param.win_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    param.win_flag = win_flag;
+    param.prevalent_wind = wind_t::EAST;
+    param.seat_wind = wind_t::EAST;
+
+    // 转换成紧凑的算番结果再转换回来，应与原来的算番表一致
+    fan_table_t fan_table;
+    int fan = calculate_fan(&param, &fan_table);
+    if (fan < 0) {
+        printf("error at line %d error = %d\n", __LINE__, fan);
+        return;
+    }
+    fan_result_t fan_result;
+    fan_table_t temp_table;
+    bool same = fan_table_to_result(fan_table, &fan_result);
+    if (same) {
+        fan_result_to_table(fan_result, &temp_table);
+        same = memcmp(fan_table, temp_table, sizeof(fan_table)) == 0 && get_fan_by_result(fan_result) == fan;
+    }
+    printf("%s fan_result: %d %s\n", str, fan, same ? "OK" : "FAILED");
+}
+
+void test_cache(const char *str, win_flag_t win_flag) {
+    calculate_param_t param;
+    memset(&param, 0, sizeof(param));
+    long ret = string_to_tiles(str, &param.hand_tiles, &param.win_tile);
+    if (ret != 0) {
+        printf("error at line %d error = %ld\n", __LINE__, ret);
+        return;
+    }
+
+    param.win_flag = win_flag;
+    param.prevalent_wind = wind_t::EAST;
+    param.seat_wind = wind_t::EAST;
+
+    cache_clear();
+    cache_reset_stats();
+
+    // 未命中与命中各一次，均与直接算番的结果比较
+    fan_table_t fan_table;
+    int fan = calculate_fan(&param, &fan_table);
+    bool ok = true;
+    for (int i = 0; i < 2; ++i) {
+        fan_table_t cached_fan_table;
+        int cached_fan = cached_calculate_fan(&param, &cached_fan_table);
+        ok = ok && cached_fan == fan && memcmp(fan_table, cached_fan_table, sizeof(fan_table)) == 0;
+    }
+
+    cache_stats_t stats;
+    cache_get_stats(&stats);
+    printf("%s cached: %d fan, hit %d miss %d %s\n", str, fan, (int)stats.hit_count, (int)stats.miss_count, ok ? "OK" : "FAILED");
+}
+
+void test_cache_suits(const char *str1, const char *str2) {
+    calculate_param_t params[2];
+    const char *strs[2] = { str1, str2 };
+    for (int i = 0; i < 2; ++i) {
+        memset(&params[i], 0, sizeof(params[i]));
+        long ret = string_to_tiles(strs[i], &params[i].hand_tiles, &params[i].win_tile);
+        if (ret != 0) {
+            printf("error at line %d error = %ld\n", __LINE__, ret);
+            return;
+        }
+        params[i].win_flag = WIN_FLAG_DISCARD;
+        params[i].prevalent_wind = wind_t::EAST;
+        params[i].seat_wind = wind_t::EAST;
+    }
+
+    cache_clear();
+    cache_reset_stats();
+
+    // 花色互换的两手牌，能安全置换时第二次命中缓存
+    bool ok = true;
+    int fans[2];
+    for (int i = 0; i < 2; ++i) {
+        fan_table_t fan_table, cached_fan_table;
+        fans[i] = calculate_fan(&params[i], &fan_table);
+        int cached_fan = cached_calculate_fan(&params[i], &cached_fan_table);
+        ok = ok && cached_fan == fans[i] && memcmp(fan_table, cached_fan_table, sizeof(fan_table)) == 0;
+    }
+
+    cache_stats_t stats;
+    cache_get_stats(&stats);
+    printf("%s %s cached: %d %d fan, hit %d miss %d %s\n", str1, str2, fans[0], fans[1], (int)stats.hit_count, (int)stats.miss_count, ok ? "OK" : "FAILED");
+}
+
 int main(int argc, const char *argv[]) {
 #ifdef _MSC_VER
     system("chcp 65001");
@@ -151,6 +446,21 @@ int main(int argc, const char *argv[]) {
     //test_shanten("278m3378s3779pEC");
     test_shanten("111m 5m12p1569sSWP");
     test_shanten("[111m]5m12p1569sSWP");
+    test_shanten_state("258m369s144567pE", TILE_8p, TILE_E);
+    test_tile_counts();
+    test_discards("258m369s144567pE8p", FORM_FLAG_BASIC_FORM | FORM_FLAG_KNITTED_STRAIGHT);
+    test_fan_for_waits("1112345678999p", WIN_FLAG_DISCARD);
+    test_fan_for_waits("[123m]25558m369s147p", WIN_FLAG_SELF_DRAWN);
+    test_fan_threshold("1112345678999p9p", WIN_FLAG_DISCARD, 8);
+    test_fan_threshold("123456m45679p66s8p", WIN_FLAG_DISCARD, 8);
+    test_fan_threshold("123456m45679p66s1p", WIN_FLAG_DISCARD, 8);
+    test_fan_result("1112345678999p9p", WIN_FLAG_DISCARD);
+    test_fan_result("[123m][789p]789s1299p3p", WIN_FLAG_DISCARD);
+    test_cache("1112345678999p9p", WIN_FLAG_DISCARD);
+    test_cache("[123m][789p]789s1299p3p", WIN_FLAG_DISCARD);
+    test_cache_suits("[123m][789p]789s1299p3p", "[123p][789s]789m1299s3s");
+    test_cache_suits("223344666888sFF", "223344666888mFF");
+    puts("");
     //return 0;
 
 #if 1
@@ -507,3 +817,4 @@ int main(int argc, const char *argv[]) {
 #include "stringify.cpp"
 #include "shanten.cpp"
 #include "fan_calculator.cpp"
+#include "cache.cpp"
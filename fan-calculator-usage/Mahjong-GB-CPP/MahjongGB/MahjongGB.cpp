@@ -3,96 +3,207 @@
 #include <utility>
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include "../../ChineseOfficialMahjongHelper/Classes/mahjong-algorithm/fan_calculator.h"
 #include <cstring>
 #include <iostream>
 
 using namespace std;
 
-static unordered_map<string, mahjong::tile_t> str2tile;
+static_assert(MahjongTileFromCode("W1") == 0x11 && MahjongTileFromCode("T9") == 0x29 && MahjongTileFromCode("B5") == 0x35, "wrong suit code");
+static_assert(MahjongTileFromCode("F4") == 0x44 && MahjongTileFromCode("J1") == 0x45 && MahjongTileFromCode("J3") == 0x47, "wrong honor code");
+static_assert(MahjongTileFromCode("F5") == 0 && MahjongTileFromCode("J4") == 0 && MahjongTileFromCode("W0") == 0 && MahjongTileFromCode("w1") == 0, "invalid code accepted");
+static_assert(MahjongTileCodeSuit(0x47) == 'J' && MahjongTileCodeRank(0x47) == '3' && MahjongTileCodeSuit(0x29) == 'T', "wrong tile code");
 
-vector<pair<int, string> > MahjongFanCalculator(
-    vector<pair<string, pair<string, int> > > pack,
-    vector<string> hand,
-    string winTile,
-    int flowerCount,
-    bool isZIMO,
-    bool isJUEZHANG,
-    bool isGANG,
-    bool isLAST,
-    int menFeng,
-    int quanFeng)
+bool MahjongIsValidPack(mahjong::pack_t pack)
 {
-    vector<pair<int,string>> ans;
-    mahjong::calculate_param_t calculate_param;
-    mahjong::fan_table_t fan_table;
+    mahjong::tile_t tile = mahjong::pack_get_tile(pack);
+    if(!mahjong::is_tile_countable(tile)) {
+        return false;
+    }
+    switch(mahjong::pack_get_type(pack)) {
+    case PACK_TYPE_CHOW:
+        return mahjong::tile_get_suit(tile) != TILE_SUIT_HONORS && mahjong::tile_get_rank(tile) >= 2 && mahjong::tile_get_rank(tile) <= 8;
+    case PACK_TYPE_PUNG:
+    case PACK_TYPE_KONG:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int MakeCalculateParam(
+    const mahjong::pack_t *packs,
+    int packCount,
+    const mahjong::tile_t *hand,
+    int handCount,
+    mahjong::tile_t winTile,
+    const MahjongWinFlags &flags,
+    mahjong::calculate_param_t &calculate_param)
+{
+    if(packCount < 0 || packCount > 4 || handCount < 0 || handCount > 13) {
+        return ERROR_WRONG_TILES_COUNT;
+    }
     memset(&calculate_param, 0, sizeof(mahjong::calculate_param_t));
-    memset(&fan_table, 0, sizeof(mahjong::fan_table_t));
-    calculate_param.hand_tiles.tile_count = hand.size();
-    for(unsigned int i = 0; i < hand.size(); i++) {
-        if(str2tile.find(hand[i]) == str2tile.end()){
-            throw string("ERROE_WRONG_TILE_CODE");
+    calculate_param.hand_tiles.tile_count = handCount;
+    for(int i = 0; i < handCount; i++) {
+        if(!mahjong::is_tile_countable(hand[i])) {
+            return MAHJONG_ERROR_WRONG_TILE_CODE;
         }
-        calculate_param.hand_tiles.standing_tiles[i] = str2tile[hand[i]];
+        calculate_param.hand_tiles.standing_tiles[i] = hand[i];
     }
-    calculate_param.hand_tiles.pack_count = pack.size();
-    for(unsigned int i = 0; i < pack.size(); i++) {
-        pair<string, pair<string, int>> &sPack = pack[i];
-        mahjong::pack_t &dPack = calculate_param.hand_tiles.fixed_packs[i];
-        if(sPack.first == "PENG") {
-            dPack = mahjong::make_pack(sPack.second.second, PACK_TYPE_PUNG, str2tile[sPack.second.first]);
-        } else if(sPack.first == "GANG") {
-            dPack = mahjong::make_pack(sPack.second.second, PACK_TYPE_KONG, str2tile[sPack.second.first]);
-        } else if(sPack.first == "CHI"){
-            dPack = mahjong::make_pack(sPack.second.second, PACK_TYPE_CHOW, str2tile[sPack.second.first]);
-        } else {
-            throw string("ERROE_WRONG_PACK_CODE");
+    calculate_param.hand_tiles.pack_count = packCount;
+    for(int i = 0; i < packCount; i++) {
+        if(!MahjongIsValidPack(packs[i])) {
+            return MAHJONG_ERROR_WRONG_PACK_CODE;
         }
+        calculate_param.hand_tiles.fixed_packs[i] = packs[i];
+    }
+    if(!mahjong::is_tile_countable(winTile)) {
+        return MAHJONG_ERROR_WRONG_TILE_CODE;
     }
-    calculate_param.win_tile = str2tile[winTile];
-    calculate_param.flower_count = flowerCount;
-    if(isZIMO) {
+    calculate_param.win_tile = winTile;
+    calculate_param.flower_count = flags.flowerCount;
+    if(flags.isZIMO) {
         calculate_param.win_flag |= WIN_FLAG_SELF_DRAWN;
     }
-    if(isLAST) {
+    if(flags.isLAST) {
         calculate_param.win_flag |= WIN_FLAG_WALL_LAST;
     }
-    if(isJUEZHANG) {
+    if(flags.isJUEZHANG) {
         calculate_param.win_flag |= WIN_FLAG_4TH_TILE;
     }
-    if(isGANG) {
+    if(flags.isGANG) {
         calculate_param.win_flag |= WIN_FLAG_ABOUT_KONG;
     }
-    calculate_param.prevalent_wind = (mahjong::wind_t)quanFeng;
-    calculate_param.seat_wind = (mahjong::wind_t)menFeng;
-    int re = mahjong::calculate_fan(&calculate_param, &fan_table);
-    if(re == -1) {
-        throw string("ERROR_WRONG_TILES_COUNT");
-    }else if(re == -2) {
-        throw string("ERROR_TILE_COUNT_GREATER_THAN_4");
-    }else if(re == -3) {
-        throw string("ERROR_NOT_WIN");
+    calculate_param.prevalent_wind = (mahjong::wind_t)flags.quanFeng;
+    calculate_param.seat_wind = (mahjong::wind_t)flags.menFeng;
+    return 0;
+}
+
+int MahjongFanCalculator(
+    const mahjong::pack_t *packs,
+    int packCount,
+    const mahjong::tile_t *hand,
+    int handCount,
+    mahjong::tile_t winTile,
+    const MahjongWinFlags &flags,
+    MahjongFanResult *result)
+{
+    result->fanCount = 0;
+    mahjong::calculate_param_t calculate_param;
+    int re = MakeCalculateParam(packs, packCount, hand, handCount, winTile, flags, calculate_param);
+    if(re != 0) {
+        return re;
+    }
+    mahjong::fan_table_t fan_table;
+    memset(&fan_table, 0, sizeof(mahjong::fan_table_t));
+    re = mahjong::calculate_fan(&calculate_param, &fan_table);
+    if(re < 0) {
+        return re;
     }
     for(int i = 0; i < mahjong::FAN_TABLE_SIZE; i++) {
         if(fan_table[i] > 0) {
-            ans.push_back(make_pair(fan_table[i]*mahjong::fan_value_table[i],mahjong::fan_name[i]));
+            MahjongFan &fan = result->fans[result->fanCount++];
+            fan.fanId = i;
+            fan.count = fan_table[i];
+            fan.point = fan_table[i] * mahjong::fan_value_table[i];
         }
     }
-    return ans;
+    return re;
 }
 
-void MahjongInit()
+//字符串版的参数转换成牌与副露，副露或手牌超过容量时只转换容量以内的部分
+static void ParseHand(
+    const vector<pair<string, pair<string, int> > > &pack,
+    const vector<string> &hand,
+    mahjong::pack_t (&packs)[4],
+    mahjong::tile_t (&tiles)[13])
 {
-    for(int i = 1; i <= 9; i++) {
-        str2tile["W" + to_string(i)] = mahjong::make_tile(TILE_SUIT_CHARACTERS, i);
-        str2tile["B" + to_string(i)] = mahjong::make_tile(TILE_SUIT_DOTS, i);
-        str2tile["T" + to_string(i)] = mahjong::make_tile(TILE_SUIT_BAMBOO, i);
+    for(unsigned int i = 0; i < hand.size() && i < 13; i++) {
+        tiles[i] = MahjongTileFromCode(hand[i]);
+        if(tiles[i] == 0){
+            throw string("ERROE_WRONG_TILE_CODE");
+        }
     }
-    for(int i = 1; i <= 4; i++) {
-        str2tile["F" + to_string((i))] = mahjong::make_tile(TILE_SUIT_HONORS, i);
+    for(unsigned int i = 0; i < pack.size() && i < 4; i++) {
+        const pair<string, pair<string, int>> &sPack = pack[i];
+        mahjong::tile_t tile = MahjongTileFromCode(sPack.second.first);
+        if(sPack.first == "PENG") {
+            packs[i] = mahjong::make_pack(sPack.second.second, PACK_TYPE_PUNG, tile);
+        } else if(sPack.first == "GANG") {
+            packs[i] = mahjong::make_pack(sPack.second.second, PACK_TYPE_KONG, tile);
+        } else if(sPack.first == "CHI"){
+            packs[i] = mahjong::make_pack(sPack.second.second, PACK_TYPE_CHOW, tile);
+        } else {
+            throw string("ERROE_WRONG_PACK_CODE");
+        }
+    }
+}
+
+//错误码转换成字符串版抛出的异常
+static void ThrowError(int re)
+{
+    switch(re) {
+    case ERROR_WRONG_TILES_COUNT: throw string("ERROR_WRONG_TILES_COUNT");
+    case ERROR_TILE_COUNT_GREATER_THAN_4: throw string("ERROR_TILE_COUNT_GREATER_THAN_4");
+    case ERROR_NOT_WIN: throw string("ERROR_NOT_WIN");
+    case MAHJONG_ERROR_WRONG_TILE_CODE: throw string("ERROE_WRONG_TILE_CODE");
+    case MAHJONG_ERROR_WRONG_PACK_CODE: throw string("ERROE_WRONG_PACK_CODE");
+    default: break;
+    }
+}
+
+vector<pair<int, string> > MahjongFanCalculator(
+    vector<pair<string, pair<string, int> > > pack,
+    vector<string> hand,
+    string winTile,
+    int flowerCount,
+    bool isZIMO,
+    bool isJUEZHANG,
+    bool isGANG,
+    bool isLAST,
+    int menFeng,
+    int quanFeng)
+{
+    mahjong::pack_t packs[4];
+    mahjong::tile_t tiles[13];
+    ParseHand(pack, hand, packs, tiles);
+    MahjongWinFlags flags = { flowerCount, isZIMO, isJUEZHANG, isGANG, isLAST, menFeng, quanFeng };
+    MahjongFanResult result;
+    int re = MahjongFanCalculator(packs, (int)pack.size(), tiles, (int)hand.size(), MahjongTileFromCode(winTile), flags, &result);
+    if(re < 0) {
+        ThrowError(re);
+    }
+    vector<pair<int,string>> ans;
+    for(int i = 0; i < result.fanCount; i++) {
+        ans.push_back(make_pair(result.fans[i].point, mahjong::fan_name[result.fans[i].fanId]));
     }
-    for(int i = 1; i <= 3; i++) {
-        str2tile["J" + to_string((i))] = mahjong::make_tile(TILE_SUIT_HONORS, i + 4);
+    return ans;
+}
+
+bool MahjongFanThreshold(
+    const vector<pair<string, pair<string, int> > > &pack,
+    const vector<string> &hand,
+    const string &winTile,
+    bool isZIMO,
+    bool isJUEZHANG,
+    bool isGANG,
+    bool isLAST,
+    int menFeng,
+    int quanFeng,
+    int minFan)
+{
+    mahjong::pack_t packs[4];
+    mahjong::tile_t tiles[13];
+    ParseHand(pack, hand, packs, tiles);
+    MahjongWinFlags flags = { 0, isZIMO, isJUEZHANG, isGANG, isLAST, menFeng, quanFeng };
+    mahjong::calculate_param_t calculate_param;
+    if(MakeCalculateParam(packs, (int)pack.size(), tiles, (int)hand.size(), MahjongTileFromCode(winTile), flags, calculate_param) != 0) {
+        return false;
     }
-}
\ No newline at end of file
+    return mahjong::meets_fan_threshold(&calculate_param, minFan);
+}
+
+void MahjongInit()
+{
+}
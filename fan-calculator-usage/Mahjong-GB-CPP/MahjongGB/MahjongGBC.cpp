@@ -0,0 +1,186 @@
+#include "MahjongGBC.h"
+#include "MahjongGB.h"
+#include <string.h>
+#include <limits>
+#include "../../ChineseOfficialMahjongHelper/Classes/mahjong-algorithm/shanten.h"
+#include "../../ChineseOfficialMahjongHelper/Classes/mahjong-algorithm/fan_calculator.h"
+
+static_assert(sizeof(MahjongCHandTiles) == 26 && sizeof(MahjongCCalculateParam) == 32 && sizeof(MahjongCDiscardResult) == 16, "C ABI layout changed");
+static_assert(MAHJONG_C_FAN_TABLE_SIZE == mahjong::FAN_TABLE_SIZE && MAHJONG_C_MAX_DISCARD_RESULT == MAX_DISCARD_RESULT_CNT, "C ABI size mismatch");
+static_assert(MAHJONG_C_INVALID_SHANTEN == std::numeric_limits<int>::max(), "C ABI shanten mismatch");
+static_assert(MAHJONG_C_ERROR_WRONG_TILES_COUNT == ERROR_WRONG_TILES_COUNT && MAHJONG_C_ERROR_TILE_COUNT_GREATER_THAN_4 == ERROR_TILE_COUNT_GREATER_THAN_4
+    && MAHJONG_C_ERROR_NOT_WIN == ERROR_NOT_WIN && MAHJONG_C_ERROR_WRONG_TILE_CODE == MAHJONG_ERROR_WRONG_TILE_CODE
+    && MAHJONG_C_ERROR_WRONG_PACK_CODE == MAHJONG_ERROR_WRONG_PACK_CODE, "C ABI error code mismatch");
+
+//转换手牌，检查张数不超过容量、牌与副露合法
+static int ConvertHandTiles(const MahjongCHandTiles *in, mahjong::hand_tiles_t *out)
+{
+    if(in->packCount > 4 || in->tileCount > 13) {
+        return ERROR_WRONG_TILES_COUNT;
+    }
+    memset(out, 0, sizeof(mahjong::hand_tiles_t));
+    out->pack_count = in->packCount;
+    for(int i = 0; i < in->packCount; i++) {
+        if(!MahjongIsValidPack(in->fixedPacks[i])) {
+            return MAHJONG_ERROR_WRONG_PACK_CODE;
+        }
+        out->fixed_packs[i] = in->fixedPacks[i];
+    }
+    out->tile_count = in->tileCount;
+    for(int i = 0; i < in->tileCount; i++) {
+        if(!mahjong::is_tile_countable(in->standingTiles[i])) {
+            return MAHJONG_ERROR_WRONG_TILE_CODE;
+        }
+        out->standing_tiles[i] = in->standingTiles[i];
+    }
+    return 0;
+}
+
+//检查立牌数为3n+1，立牌与上牌中每种牌不超过4张
+static int CheckStandingTiles(const mahjong::hand_tiles_t &hand_tiles, mahjong::tile_t servingTile)
+{
+    if(hand_tiles.tile_count % 3 != 1) {
+        return ERROR_WRONG_TILES_COUNT;
+    }
+    if(servingTile != 0 && !mahjong::is_tile_countable(servingTile)) {
+        return MAHJONG_ERROR_WRONG_TILE_CODE;
+    }
+    mahjong::tile_table_t cnt_table;
+    mahjong::map_tiles(hand_tiles.standing_tiles, hand_tiles.tile_count, &cnt_table);
+    if(servingTile != 0 && ++cnt_table[servingTile] > 4) {
+        return ERROR_TILE_COUNT_GREATER_THAN_4;
+    }
+    for(int i = 0; i < 34; i++) {
+        if(cnt_table[mahjong::all_tiles[i]] > 4) {
+            return ERROR_TILE_COUNT_GREATER_THAN_4;
+        }
+    }
+    return 0;
+}
+
+int32_t MahjongCCalculateFan(const MahjongCCalculateParam *param, uint16_t *fanTable)
+{
+    mahjong::calculate_param_t calculate_param;
+    memset(&calculate_param, 0, sizeof(mahjong::calculate_param_t));
+    int re = ConvertHandTiles(&param->handTiles, &calculate_param.hand_tiles);
+    if(re != 0) {
+        return re;
+    }
+    if(!mahjong::is_tile_countable(param->winTile)) {
+        return MAHJONG_ERROR_WRONG_TILE_CODE;
+    }
+    if(param->prevalentWind > 3 || param->seatWind > 3) {
+        return MAHJONG_C_ERROR_WRONG_WIND;
+    }
+    calculate_param.win_tile = param->winTile;
+    calculate_param.flower_count = param->flowerCount;
+    calculate_param.win_flag = param->winFlag;
+    calculate_param.prevalent_wind = (mahjong::wind_t)param->prevalentWind;
+    calculate_param.seat_wind = (mahjong::wind_t)param->seatWind;
+
+    mahjong::fan_table_t fan_table;
+    memset(&fan_table, 0, sizeof(mahjong::fan_table_t));
+    re = mahjong::calculate_fan(&calculate_param, &fan_table);
+    if(fanTable != NULL) {
+        memcpy(fanTable, fan_table, sizeof(mahjong::fan_table_t));
+    }
+    return re;
+}
+
+void MahjongCCalculateFanBatch(const MahjongCCalculateParam *params, int32_t count, uint16_t *fanTables, int32_t *fans)
+{
+    for(int32_t i = 0; i < count; i++) {
+        fans[i] = MahjongCCalculateFan(&params[i], fanTables != NULL ? fanTables + (size_t)i * MAHJONG_C_FAN_TABLE_SIZE : NULL);
+    }
+}
+
+int32_t MahjongCBasicFormShanten(const MahjongCHandTiles *handTiles, uint64_t *usefulTiles)
+{
+    if(usefulTiles != NULL) {
+        *usefulTiles = 0;
+    }
+    mahjong::hand_tiles_t hand_tiles;
+    if(ConvertHandTiles(handTiles, &hand_tiles) != 0 || CheckStandingTiles(hand_tiles, 0) != 0) {
+        return MAHJONG_C_INVALID_SHANTEN;
+    }
+    mahjong::useful_table_t useful_table;
+    int ret = mahjong::basic_form_shanten(hand_tiles.standing_tiles, hand_tiles.tile_count, usefulTiles != NULL ? &useful_table : NULL);
+    if(usefulTiles != NULL && ret != MAHJONG_C_INVALID_SHANTEN) {
+        *usefulTiles = mahjong::useful_table_to_tile_set(useful_table);
+    }
+    return ret;
+}
+
+void MahjongCBasicFormShantenBatch(const MahjongCHandTiles *handTiles, int32_t count, int32_t *shantens, uint64_t *usefulTiles)
+{
+    for(int32_t i = 0; i < count; i++) {
+        shantens[i] = MahjongCBasicFormShanten(&handTiles[i], usefulTiles != NULL ? &usefulTiles[i] : NULL);
+    }
+}
+
+int32_t MahjongCIsWaiting(const MahjongCHandTiles *handTiles, uint64_t *waitingTiles)
+{
+    if(waitingTiles != NULL) {
+        *waitingTiles = 0;
+    }
+    mahjong::hand_tiles_t hand_tiles;
+    int re = ConvertHandTiles(handTiles, &hand_tiles);
+    if(re == 0) {
+        re = CheckStandingTiles(hand_tiles, 0);
+    }
+    if(re == 0 && hand_tiles.pack_count * 3 + hand_tiles.tile_count != 13) {
+        re = ERROR_WRONG_TILES_COUNT;
+    }
+    if(re != 0) {
+        return re;
+    }
+    mahjong::useful_table_t useful_table;
+    bool waiting = mahjong::is_waiting(hand_tiles, &useful_table);
+    if(waitingTiles != NULL && waiting) {
+        *waitingTiles = mahjong::useful_table_to_tile_set(useful_table);
+    }
+    return waiting ? 1 : 0;
+}
+
+void MahjongCIsWaitingBatch(const MahjongCHandTiles *handTiles, int32_t count, int32_t *results, uint64_t *waitingTiles)
+{
+    for(int32_t i = 0; i < count; i++) {
+        results[i] = MahjongCIsWaiting(&handTiles[i], waitingTiles != NULL ? &waitingTiles[i] : NULL);
+    }
+}
+
+int32_t MahjongCEvaluateDiscards(const MahjongCHandTiles *handTiles, uint8_t servingTile, uint8_t formFlag, MahjongCDiscardResult *results)
+{
+    mahjong::hand_tiles_t hand_tiles;
+    int re = ConvertHandTiles(handTiles, &hand_tiles);
+    if(re == 0) {
+        re = CheckStandingTiles(hand_tiles, servingTile);
+    }
+    if(re == 0 && hand_tiles.pack_count * 3 + hand_tiles.tile_count != 13) {
+        re = ERROR_WRONG_TILES_COUNT;
+    }
+    if(re != 0) {
+        return re;
+    }
+    mahjong::enum_result_t enum_results[MAX_DISCARD_RESULT_CNT];
+    intptr_t cnt = mahjong::evaluate_all_discards(&hand_tiles, servingTile, formFlag, enum_results);
+    for(intptr_t i = 0; i < cnt; i++) {
+        MahjongCDiscardResult &result = results[i];
+        result.usefulTiles = mahjong::useful_table_to_tile_set(enum_results[i].useful_table);
+        result.shanten = enum_results[i].shanten;
+        result.discardTile = enum_results[i].discard_tile;
+        result.formFlag = enum_results[i].form_flag;
+        result.reserved[0] = 0;
+        result.reserved[1] = 0;
+    }
+    return (int32_t)cnt;
+}
+
+void MahjongCEvaluateDiscardsBatch(const MahjongCHandTiles *handTiles, const uint8_t *servingTiles, int32_t count, uint8_t formFlag,
+    MahjongCDiscardResult *results, int32_t *resultCounts)
+{
+    for(int32_t i = 0; i < count; i++) {
+        resultCounts[i] = MahjongCEvaluateDiscards(&handTiles[i], servingTiles != NULL ? servingTiles[i] : 0, formFlag,
+            results + (size_t)i * MAHJONG_C_MAX_DISCARD_RESULT);
+    }
+}
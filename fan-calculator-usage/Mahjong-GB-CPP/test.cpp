@@ -1,3 +1,4 @@
+#define MAHJONGGB_UNITY
 #include "MahjongGB/MahjongGB.h"
 #include <iostream>
 using namespace std;
@@ -32,5 +33,21 @@ int main() {
     }catch(const string &error){
         cout << error << endl;
     }
+    cout << "----------" << endl;
+
+    //Typed API: no allocation, no exception
+    mahjong::pack_t packs[] = {mahjong::make_pack(1, PACK_TYPE_KONG, mahjong::TILE_1m)};
+    mahjong::tile_t hand[] = {mahjong::TILE_2m, mahjong::TILE_2m, mahjong::TILE_2m, mahjong::TILE_3m, mahjong::TILE_3m,
+        mahjong::TILE_3m, mahjong::TILE_4m, mahjong::TILE_4m, mahjong::TILE_4m, mahjong::TILE_5m};
+    MahjongWinFlags flags = {1, false, false, false, false, 0, 0};
+    MahjongFanResult result;
+    int re = MahjongFanCalculator(packs, 1, hand, 10, mahjong::TILE_5m, flags, &result);
+    if(re < 0){
+        cout << "error " << re << endl;
+    }else{
+        for(int i = 0; i < result.fanCount; i++){
+            cout << result.fans[i].point << " " << mahjong::fan_name[result.fans[i].fanId] << endl;
+        }
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "MahjongGB/MahjongGBC.h"
+#include <stdio.h>
+#include <string.h>
+
+/* tile_t与pack_t的编码：牌为花色<<4|点数（万条饼字依次为1234），副露为供牌<<12|类型<<8|牌（吃碰杠依次为123） */
+#define TILE(suit, rank) ((uint8_t)((suit) << 4 | (rank)))
+#define PACK(offer, type, tile) ((uint16_t)((offer) << 12 | (type) << 8 | (tile)))
+
+int main(void) {
+    MahjongCCalculateParam params[2];
+    int32_t fans[2];
+    uint16_t fanTables[2][MAHJONG_C_FAN_TABLE_SIZE];
+    int32_t shantens[2];
+    uint64_t usefulTiles[2];
+    int i;
+
+    /* 明杠1万，立牌222333444万5万，和5万 */
+    memset(params, 0, sizeof(params));
+    params[0].handTiles.fixedPacks[0] = PACK(1, 3, TILE(1, 1));
+    params[0].handTiles.packCount = 1;
+    for (i = 0; i < 9; i++) {
+        params[0].handTiles.standingTiles[i] = TILE(1, 2 + i / 3);
+    }
+    params[0].handTiles.standingTiles[9] = TILE(1, 5);
+    params[0].handTiles.tileCount = 10;
+    params[0].winTile = TILE(1, 5);
+    params[0].flowerCount = 1;
+
+    /* 同样的立牌和7万，不和，返回MAHJONG_C_ERROR_NOT_WIN */
+    params[1] = params[0];
+    params[1].winTile = TILE(1, 7);
+
+    MahjongCCalculateFanBatch(params, 2, &fanTables[0][0], fans);
+    for (i = 0; i < 2; i++) {
+        printf("hand %d: %d\n", i, (int)fans[i]);
+    }
+    printf("FOUR_PURE_SHIFTED_PUNGS x%d\n", (int)fanTables[0][15]);  /* 一色四节高 */
+
+    /* 门风只能是0~3，否则返回MAHJONG_C_ERROR_WRONG_WIND */
+    params[1].seatWind = 4;
+    printf("wrong wind: %d\n", (int)MahjongCCalculateFan(&params[1], NULL));
+
+    MahjongCHandTiles hands[2];
+    hands[0] = params[0].handTiles;
+    hands[1] = params[0].handTiles;
+    hands[1].standingTiles[9] = TILE(4, 7);
+    MahjongCBasicFormShantenBatch(hands, 2, shantens, usefulTiles);
+    for (i = 0; i < 2; i++) {
+        printf("shanten %d: %d useful %llx\n", i, (int)shantens[i], (unsigned long long)usefulTiles[i]);
+    }
+    return 0;
+}
@@ -1,7 +1,13 @@
 #include <Python.h>
 #include "../Mahjong-GB-CPP/MahjongGB/MahjongGB.h"
+#include "../Mahjong-GB-CPP/MahjongGB/MahjongGBC.h"
 #include <iostream>
 #include <stdio.h>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
 static PyObject *oMahjongFanCalculator(PyObject *self, PyObject *args)
 {
     vector<pair<string, pair<string, int> > > pack;
@@ -47,8 +53,171 @@ static PyObject *oMahjongFanCalculator(PyObject *self, PyObject *args)
     }
     return PyList_AsTuple(oAns);
 }
+
+//把[0, count)分成若干段，在threads个线程中分别计算，threads为0时使用硬件线程数
+//调用前须已释放GIL
+template <class Func>
+static void ParallelFor(Py_ssize_t count, int threads, Func func)
+{
+    if(threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    Py_ssize_t step = (count + threads - 1) / threads;
+    if(threads == 1 || step < 1024) {
+        func(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    Py_ssize_t begin = step;
+    try {
+        for(; begin < count; begin += step) {
+            workers.emplace_back(func, begin, std::min(begin + step, count));
+        }
+    } catch(...) {
+        //线程创建失败，剩下的区间由当前线程处理，不能让异常穿过C回调
+        func(begin, count);
+    }
+    func(0, step);
+    for(std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+//C接口的批量函数一次最多处理的条数
+#define BATCH_CHUNK_SIZE (1 << 20)
+
+//取得记录数组的缓冲区，长度须为recordSize的整数倍
+static bool GetRecords(PyObject *obj, Py_ssize_t recordSize, Py_buffer *view, Py_ssize_t *count)
+{
+    if(PyObject_GetBuffer(obj, view, PyBUF_SIMPLE) != 0) {
+        return false;
+    }
+    if(view->len % recordSize != 0) {
+        PyBuffer_Release(view);
+        PyErr_Format(PyExc_ValueError, "buffer size %zd is not a multiple of the record size %zd", view->len, recordSize);
+        return false;
+    }
+    *count = view->len / recordSize;
+    return true;
+}
+
+//结果数组：在bytearray上建立指定格式的memoryview，numpy可以不复制直接使用
+//columns不为0时为count行columns列的二维数组，memoryview不能转换出含0的形状，count为0时仍为一维
+static PyObject *MakeResultView(PyObject *bytes, const char *format, Py_ssize_t count, Py_ssize_t columns)
+{
+    PyObject *view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if(view == NULL) {
+        return NULL;
+    }
+    PyObject *cast = columns == 0 || count == 0 ? PyObject_CallMethod(view, "cast", "s", format)
+        : PyObject_CallMethod(view, "cast", "s(nn)", format, count, columns);
+    Py_DECREF(view);
+    return cast;
+}
+
+static PyObject *oCalculateFanBatch(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"params", "fan_tables", "threads", NULL};
+    PyObject *oParams;
+    int withTables = 0;
+    int threads = 1;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pi", (char **)keywords, &oParams, &withTables, &threads)) {
+        return NULL;
+    }
+    Py_buffer view;
+    Py_ssize_t count;
+    if(!GetRecords(oParams, sizeof(MahjongCCalculateParam), &view, &count)) {
+        return NULL;
+    }
+    PyObject *oFans = PyByteArray_FromStringAndSize(NULL, count * sizeof(int32_t));
+    PyObject *oTables = withTables ? PyByteArray_FromStringAndSize(NULL, count * MAHJONG_C_FAN_TABLE_SIZE * sizeof(uint16_t)) : NULL;
+    if(oFans == NULL || (withTables && oTables == NULL)) {
+        Py_XDECREF(oFans);
+        Py_XDECREF(oTables);
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    const MahjongCCalculateParam *params = (const MahjongCCalculateParam *)view.buf;
+    int32_t *fans = (int32_t *)PyByteArray_AS_STRING(oFans);
+    uint16_t *tables = withTables ? (uint16_t *)PyByteArray_AS_STRING(oTables) : NULL;
+    Py_BEGIN_ALLOW_THREADS
+    ParallelFor(count, threads, [=](Py_ssize_t begin, Py_ssize_t end) {
+        for(Py_ssize_t i = begin; i < end; i += BATCH_CHUNK_SIZE) {
+            int32_t n = (int32_t)std::min<Py_ssize_t>(end - i, BATCH_CHUNK_SIZE);
+            MahjongCCalculateFanBatch(params + i, n, tables != NULL ? tables + i * MAHJONG_C_FAN_TABLE_SIZE : NULL, fans + i);
+        }
+    });
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    PyObject *oFanView = MakeResultView(oFans, "i", count, 0);
+    if(!withTables) {
+        return oFanView;
+    }
+    PyObject *oTableView = MakeResultView(oTables, "H", count, MAHJONG_C_FAN_TABLE_SIZE);
+    if(oFanView == NULL || oTableView == NULL) {
+        Py_XDECREF(oFanView);
+        Py_XDECREF(oTableView);
+        return NULL;
+    }
+    PyObject *oAns = PyTuple_Pack(2, oFanView, oTableView);
+    Py_DECREF(oFanView);
+    Py_DECREF(oTableView);
+    return oAns;
+}
+
+static PyObject *oShantenBatch(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"hands", "threads", NULL};
+    PyObject *oHands;
+    int threads = 1;
+    if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", (char **)keywords, &oHands, &threads)) {
+        return NULL;
+    }
+    Py_buffer view;
+    Py_ssize_t count;
+    if(!GetRecords(oHands, sizeof(MahjongCHandTiles), &view, &count)) {
+        return NULL;
+    }
+    PyObject *oShantens = PyByteArray_FromStringAndSize(NULL, count * sizeof(int32_t));
+    PyObject *oUseful = PyByteArray_FromStringAndSize(NULL, count * sizeof(uint64_t));
+    if(oShantens == NULL || oUseful == NULL) {
+        Py_XDECREF(oShantens);
+        Py_XDECREF(oUseful);
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    const MahjongCHandTiles *hands = (const MahjongCHandTiles *)view.buf;
+    int32_t *shantens = (int32_t *)PyByteArray_AS_STRING(oShantens);
+    uint64_t *useful = (uint64_t *)PyByteArray_AS_STRING(oUseful);
+    Py_BEGIN_ALLOW_THREADS
+    ParallelFor(count, threads, [=](Py_ssize_t begin, Py_ssize_t end) {
+        for(Py_ssize_t i = begin; i < end; i += BATCH_CHUNK_SIZE) {
+            int32_t n = (int32_t)std::min<Py_ssize_t>(end - i, BATCH_CHUNK_SIZE);
+            MahjongCBasicFormShantenBatch(hands + i, n, shantens + i, useful + i);
+        }
+    });
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    PyObject *oShantenView = MakeResultView(oShantens, "i", count, 0);
+    PyObject *oUsefulView = MakeResultView(oUseful, "Q", count, 0);
+    if(oShantenView == NULL || oUsefulView == NULL) {
+        Py_XDECREF(oShantenView);
+        Py_XDECREF(oUsefulView);
+        return NULL;
+    }
+    PyObject *oAns = PyTuple_Pack(2, oShantenView, oUsefulView);
+    Py_DECREF(oShantenView);
+    Py_DECREF(oUsefulView);
+    return oAns;
+}
+
 static PyMethodDef mahjongMethods[]={
     {"MahjongFanCalculator", oMahjongFanCalculator,METH_VARARGS,""},
+    {"calculate_fan_batch", (PyCFunction)oCalculateFanBatch, METH_VARARGS | METH_KEYWORDS, ""},
+    {"shanten_batch", (PyCFunction)oShantenBatch, METH_VARARGS | METH_KEYWORDS, ""},
     {NULL, NULL, 0, NULL},
 };
 static PyModuleDef mahjongModule = {
@@ -61,9 +230,12 @@ static PyModuleDef mahjongModule = {
 PyMODINIT_FUNC
 PyInit_MahjongGB(void) {
     PyObject* m = PyModule_Create(&mahjongModule);
-    MahjongInit();
     if (m == NULL) {
         return NULL;
     }
+    PyModule_AddIntConstant(m, "PARAM_SIZE", sizeof(MahjongCCalculateParam));
+    PyModule_AddIntConstant(m, "HAND_SIZE", sizeof(MahjongCHandTiles));
+    PyModule_AddIntConstant(m, "FAN_TABLE_SIZE", MAHJONG_C_FAN_TABLE_SIZE);
+    PyModule_AddIntConstant(m, "INVALID_SHANTEN", MAHJONG_C_INVALID_SHANTEN);
     return m;
 }
\ No newline at end of file
@@ -3,6 +3,10 @@ from setuptools import setup, Extension
 
 module = Extension('MahjongGB', sources=[
     'mahjong.cpp',
-    ], language='c++', extra_compile_args = ["-std=c++11"])
+    '../Mahjong-GB-CPP/MahjongGB/MahjongGB.cpp',
+    '../Mahjong-GB-CPP/MahjongGB/MahjongGBC.cpp',
+    '../ChineseOfficialMahjongHelper/Classes/mahjong-algorithm/fan_calculator.cpp',
+    '../ChineseOfficialMahjongHelper/Classes/mahjong-algorithm/shanten.cpp',
+    ], language='c++', extra_compile_args = ["-std=c++11", "-O3", "-flto", "-pthread"], extra_link_args = ["-flto", "-pthread"])
 
 setup(name='MahjongGB', ext_modules = [module])
@@ -24,8 +24,28 @@ else:
 
 #没和
 try:
-    ans=MahjongFanCalculator((("CHI","W1",0),),("W2","W2","W2","W3","W3","W3","W4","W4","W4","W5"),"W7",1,False,False,False,False,0,0)
+    ans=MahjongFanCalculator((("CHI","W2",0),),("W2","W2","W2","W3","W3","W3","W4","W4","W4","W5"),"W7",1,False,False,False,False,0,0)
 except Exception as err:
     print(err)
 else:
-    print(ans)
\ No newline at end of file
+    print(ans)
+
+#批量算番与上听数：每手牌为一个定长的记录，布局与MahjongGBC.h中的结构体相同
+import struct
+from MahjongGB import calculate_fan_batch, shanten_batch
+
+def make_hand(packs, tiles):
+    return struct.pack('<5HB13BBx', *(list(packs) + [0] * (5 - len(packs))), len(packs), *(list(tiles) + [0] * (13 - len(tiles))), len(tiles))
+
+def make_param(packs, tiles, winTile, flowerCount=0, winFlag=0, quanFeng=0, menFeng=0):
+    return make_hand(packs, tiles) + struct.pack('<5Bx', winTile, flowerCount, winFlag, quanFeng, menFeng)
+
+#牌为花色<<4|点数（万条饼字依次为1234），副露为供牌<<12|类型<<8|牌（吃碰杠依次为123）
+kong = 1 << 12 | 3 << 8 | 0x11
+tiles = [0x12, 0x12, 0x12, 0x13, 0x13, 0x13, 0x14, 0x14, 0x14, 0x15]
+params = make_param([kong], tiles, 0x15, 1) + make_param([kong], tiles, 0x17, 1)
+fans, fanTables = calculate_fan_batch(params, fan_tables=True, threads=0)
+print(list(fans), fanTables[0, 15])
+
+shantens, usefulTiles = shanten_batch(make_hand([kong], tiles) + make_hand([], tiles[:7]))
+print(list(shantens), [hex(x) for x in usefulTiles])
@@ -4,21 +4,101 @@
 #include <utility>
 #include <vector>
 #include <string>
+#include "../fan_calculator.h"
 
-//CPP
-#include "MahjongGB.cpp"
-#include "../fan_calculator.cpp"
-#include "../shanten.cpp"
-//Dangerous
+//作为动态库构建或使用时定义MAHJONGGB_SHARED，构建动态库时另外定义MAHJONGGB_BUILD
+#if defined(MAHJONGGB_SHARED) && defined(_WIN32)
+#ifdef MAHJONGGB_BUILD
+#define MAHJONGGB_API __declspec(dllexport)
+#else
+#define MAHJONGGB_API __declspec(dllimport)
+#endif
+#elif defined(MAHJONGGB_SHARED) && defined(__GNUC__)
+#define MAHJONGGB_API __attribute__((visibility("default")))
+#else
+#define MAHJONGGB_API
+#endif
+
+//不合法的牌或副露，其余错误码与calculate_fan相同（ERROR_WRONG_TILES_COUNT等）
+#define MAHJONG_ERROR_WRONG_TILE_CODE -4
+#define MAHJONG_ERROR_WRONG_PACK_CODE -5
+
+//和牌的条件，含义与字符串版MahjongFanCalculator的同名参数相同
+struct MahjongWinFlags {
+    int flowerCount;
+    bool isZIMO;
+    bool isJUEZHANG;
+    bool isGANG;
+    bool isLAST;
+    int menFeng;
+    int quanFeng;
+};
+
+//一种番：番种（mahjong::fan_t）、次数、番数（已乘以次数）
+struct MahjongFan {
+    int fanId;
+    int count;
+    int point;
+};
+
+//算番结果，容量固定，由调用方提供
+struct MahjongFanResult {
+    int fanCount;
+    MahjongFan fans[mahjong::FAN_TABLE_SIZE];
+};
+
+//Botzone的牌代码（W1~W9、B1~B9、T1~T9、F1~F4、J1~J3）与牌的互相转换，编译期可求值，不需要初始化
+//花色字母的低5位互不相同（B=2 F=6 J=10 T=20 W=23），直接以之为下标查表：该字母的0点对应的牌、最大点数
+static constexpr mahjong::tile_t MahjongCodeBaseTile[32] = {
+    0, 0, 0x30, 0, 0, 0, 0x40, 0, 0, 0, 0x44, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0x20, 0, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0
+};
+static constexpr int MahjongCodeMaxRank[32] = {
+    0, 0, 9, 0, 0, 0, 4, 0, 0, 0, 3, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 9, 0, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+//牌代码转换成牌，不合法的代码返回0
+constexpr mahjong::tile_t MahjongTileFromCode(char suit, char rank)
+{
+    return (suit & 0xE0) == 0x40 && rank > '0' && rank - '0' <= MahjongCodeMaxRank[suit & 0x1F]
+        ? static_cast<mahjong::tile_t>(MahjongCodeBaseTile[suit & 0x1F] + (rank - '0')) : 0;
+}
+
+constexpr mahjong::tile_t MahjongTileFromCode(const char *code)
+{
+    return code[0] != '\0' && code[1] != '\0' && code[2] == '\0' ? MahjongTileFromCode(code[0], code[1]) : 0;
+}
+
+inline mahjong::tile_t MahjongTileFromCode(const std::string &code)
+{
+    return code.size() == 2 ? MahjongTileFromCode(code[0], code[1]) : 0;
+}
+
+//牌转换成牌代码的花色字母与点数字符，tile须为合法的牌
+constexpr char MahjongTileCodeSuit(mahjong::tile_t tile)
+{
+    return (tile >> 4) == TILE_SUIT_HONORS ? ((tile & 0xF) > 4 ? 'J' : 'F') : "?WTB"[(tile >> 4) & 3];
+}
 
-using namespace std;
+constexpr char MahjongTileCodeRank(mahjong::tile_t tile)
+{
+    return static_cast<char>('0' + ((tile >> 4) == TILE_SUIT_HONORS && (tile & 0xF) > 4 ? (tile & 0xF) - 4 : (tile & 0xF)));
+}
 
-void MahjongInit();
+inline std::string MahjongTileToCode(mahjong::tile_t tile)
+{
+    const char code[3] = { MahjongTileCodeSuit(tile), MahjongTileCodeRank(tile), '\0' };
+    return code;
+}
 
-vector<pair<int, string> > MahjongFanCalculator(
-    vector<pair<string, pair<string, int> > > pack,
-    vector<string> hand,
-    string winTile,
+//牌代码的转换已不需要初始化，保留此函数只为兼容旧代码
+MAHJONGGB_API void MahjongInit();
+
+MAHJONGGB_API std::vector<std::pair<int, std::string> > MahjongFanCalculator(
+    std::vector<std::pair<std::string, std::pair<std::string, int> > > pack,
+    std::vector<std::string> hand,
+    std::string winTile,
     int flowerCount,
     bool isZIMO,
     bool isJUEZHANG,
@@ -27,4 +107,40 @@ vector<pair<int, string> > MahjongFanCalculator(
     int menFeng,
     int quanFeng);
 
+//算番，不分配内存也不抛异常，适合大量调用
+//返回总番数（含花牌），出错时返回负的错误码，此时result中没有番种
+MAHJONGGB_API int MahjongFanCalculator(
+    const mahjong::pack_t *packs,
+    int packCount,
+    const mahjong::tile_t *hand,
+    int handCount,
+    mahjong::tile_t winTile,
+    const MahjongWinFlags &flags,
+    MahjongFanResult *result);
+
+//副露是否合法：吃的中间牌为2~8的数牌，碰、杠为任意的牌
+MAHJONGGB_API bool MahjongIsValidPack(mahjong::pack_t pack);
+
+//只判断是否和牌并达到minFan番，不计花牌，不和时不抛异常
+MAHJONGGB_API bool MahjongFanThreshold(
+    const std::vector<std::pair<std::string, std::pair<std::string, int> > > &pack,
+    const std::vector<std::string> &hand,
+    const std::string &winTile,
+    bool isZIMO,
+    bool isJUEZHANG,
+    bool isGANG,
+    bool isLAST,
+    int menFeng,
+    int quanFeng,
+    int minFan);
+
+//单编译单元构建：包含本头文件之前定义MAHJONGGB_UNITY，实现连同算番、上听数、结果缓存的源文件一起编入当前编译单元
+//适合生成提交Botzone的单文件Bot；否则应将MahjongGB.cpp、fan_calculator.cpp、shanten.cpp、cache.cpp单独编译或链接libmahjonggb
+#ifdef MAHJONGGB_UNITY
+#include "MahjongGB.cpp"
+#include "../fan_calculator.cpp"
+#include "../shanten.cpp"
+#include "../cache.cpp"
+#endif
+
 #endif
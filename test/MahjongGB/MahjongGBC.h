@@ -0,0 +1,103 @@
+#ifndef MAHJONG_C_H
+#define MAHJONG_C_H
+
+#include <stdint.h>
+
+//C接口，供其他语言通过FFI调用，可以用C编译器编译
+//结构体只用定长整数，布局与编译器无关；牌、副露、和牌标记、和型标记的编码与算法库相同（tile_t、pack_t、WIN_FLAG_*、FORM_FLAG_*）
+//各函数都有批量版本，对数组中的每一项分别计算，跨语言调用的开销每批只有一次
+
+//见MahjongGB.h
+#ifndef MAHJONGGB_API
+#if defined(MAHJONGGB_SHARED) && defined(_WIN32)
+#ifdef MAHJONGGB_BUILD
+#define MAHJONGGB_API __declspec(dllexport)
+#else
+#define MAHJONGGB_API __declspec(dllimport)
+#endif
+#elif defined(MAHJONGGB_SHARED) && defined(__GNUC__)
+#define MAHJONGGB_API __attribute__((visibility("default")))
+#else
+#define MAHJONGGB_API
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//错误码，与calculate_fan及MahjongGB.h的相同
+#define MAHJONG_C_ERROR_WRONG_TILES_COUNT -1
+#define MAHJONG_C_ERROR_TILE_COUNT_GREATER_THAN_4 -2
+#define MAHJONG_C_ERROR_NOT_WIN -3
+#define MAHJONG_C_ERROR_WRONG_TILE_CODE -4
+#define MAHJONG_C_ERROR_WRONG_PACK_CODE -5
+#define MAHJONG_C_ERROR_WRONG_WIND -6           //圈风或门风大于3，仅C接口使用
+
+#define MAHJONG_C_FAN_TABLE_SIZE 83             //番表的大小，即番种数（含无效的0号）
+#define MAHJONG_C_MAX_DISCARD_RESULT 70         //一手牌打牌结果数量的上限
+#define MAHJONG_C_INVALID_SHANTEN 0x7FFFFFFF    //手牌不合法时的上听数
+
+//手牌，对应mahjong::hand_tiles_t
+typedef struct MahjongCHandTiles {
+    uint16_t fixedPacks[5];     //副露（pack_t），包括暗杠，最多4组
+    uint8_t packCount;
+    uint8_t standingTiles[13];  //立牌（tile_t）
+    uint8_t tileCount;
+} MahjongCHandTiles;
+
+//算番参数，对应mahjong::calculate_param_t
+typedef struct MahjongCCalculateParam {
+    MahjongCHandTiles handTiles;
+    uint8_t winTile;
+    uint8_t flowerCount;
+    uint8_t winFlag;            //WIN_FLAG_*的组合
+    uint8_t prevalentWind;      //圈风，0123表示东南西北
+    uint8_t seatWind;           //门风，0123表示东南西北
+} MahjongCCalculateParam;
+
+//打一张牌的结果，对应mahjong::enum_result_t
+typedef struct MahjongCDiscardResult {
+    uint64_t usefulTiles;       //有效牌，第i位对应mahjong::all_tiles[i]
+    int32_t shanten;
+    uint8_t discardTile;        //打这张牌，0表示仅计算手牌
+    uint8_t formFlag;           //和型，FORM_FLAG_*之一
+    uint8_t reserved[2];
+} MahjongCDiscardResult;
+
+//算番，fanTable可为NULL，否则容量为MAHJONG_C_FAN_TABLE_SIZE，写入各番种出现的次数
+//返回番数（含花牌），出错时返回负的错误码；圈风、门风大于3时返回MAHJONG_C_ERROR_WRONG_WIND
+MAHJONGGB_API int32_t MahjongCCalculateFan(const MahjongCCalculateParam *param, uint16_t *fanTable);
+
+//批量算番，fans容量为count；fanTables可为NULL，否则容量为count*MAHJONG_C_FAN_TABLE_SIZE
+MAHJONGGB_API void MahjongCCalculateFanBatch(const MahjongCCalculateParam *params, int32_t count, uint16_t *fanTables, int32_t *fans);
+
+//基本和型上听数，只用立牌，立牌数须为1、4、7、10、13
+//usefulTiles可为NULL，否则写入有效牌；手牌不合法时返回MAHJONG_C_INVALID_SHANTEN
+MAHJONGGB_API int32_t MahjongCBasicFormShanten(const MahjongCHandTiles *handTiles, uint64_t *usefulTiles);
+
+//批量计算基本和型上听数，shantens容量为count；usefulTiles可为NULL，否则容量为count
+MAHJONGGB_API void MahjongCBasicFormShantenBatch(const MahjongCHandTiles *handTiles, int32_t count, int32_t *shantens, uint64_t *usefulTiles);
+
+//是否听牌（含特殊和型），waitingTiles可为NULL，否则写入听的牌
+//听牌返回1，不听返回0，手牌不合法时返回负的错误码
+MAHJONGGB_API int32_t MahjongCIsWaiting(const MahjongCHandTiles *handTiles, uint64_t *waitingTiles);
+
+//批量判断是否听牌，results容量为count；waitingTiles可为NULL，否则容量为count
+MAHJONGGB_API void MahjongCIsWaitingBatch(const MahjongCHandTiles *handTiles, int32_t count, int32_t *results, uint64_t *waitingTiles);
+
+//计算打每一张牌的结果，顺序与enum_discard_tile回调的顺序相同
+//servingTile为上牌，可为0；results容量为MAHJONG_C_MAX_DISCARD_RESULT
+//返回结果的数量，手牌不合法时返回负的错误码
+MAHJONGGB_API int32_t MahjongCEvaluateDiscards(const MahjongCHandTiles *handTiles, uint8_t servingTile, uint8_t formFlag, MahjongCDiscardResult *results);
+
+//批量计算打每一张牌的结果，servingTiles可为NULL（都没有上牌），否则容量为count
+//第i手牌的结果写入results + i * MAHJONG_C_MAX_DISCARD_RESULT，数量或错误码写入resultCounts[i]
+MAHJONGGB_API void MahjongCEvaluateDiscardsBatch(const MahjongCHandTiles *handTiles, const uint8_t *servingTiles, int32_t count, uint8_t formFlag,
+    MahjongCDiscardResult *results, int32_t *resultCounts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+﻿/****************************************************************************
+ Copyright (c) 2016-2020 Jeff Wang <summer_insects@163.com>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ ****************************************************************************/
+
+#ifndef __MAHJONG_ALGORITHM__CACHE_H__
+#define __MAHJONG_ALGORITHM__CACHE_H__
+
+#include <stddef.h>
+#include "shanten.h"
+#include "fan_calculator.h"
+
+namespace mahjong {
+
+/**
+ * @brief 结果缓存
+ *  以手牌为键缓存上听数、听牌、打牌与算番的结果，重复的局面直接取缓存的结果
+ *  缓存按键的哈希值分成若干片，各片分别加锁与淘汰（最近最少使用），可以在多个线程中同时使用
+ *  cached_系列函数的参数与返回值和对应的原函数完全相同
+ *
+ * @addtogroup cache
+ * @{
+ */
+
+/**
+ * @brief 缓存的默认内存上限（字节）
+ */
+#define CACHE_DEFAULT_CAPACITY (32 * 1024 * 1024)
+
+/**
+ * @brief 缓存的统计信息
+ */
+struct cache_stats_t {
+    uint64_t hit_count;         ///< 命中次数
+    uint64_t miss_count;        ///< 未命中次数
+    uint64_t eviction_count;    ///< 因超出内存上限而淘汰的条目数
+    uint64_t entry_count;       ///< 当前的条目数
+    uint64_t memory_size;       ///< 当前估算占用的内存（字节）
+};
+
+/**
+ * @brief 设置缓存的内存上限
+ *  超出上限时淘汰最近最少使用的条目。上限为0时不缓存，cached_系列函数直接调用原函数
+ *
+ * @param [in] capacity 内存上限（字节）
+ */
+void cache_set_capacity(size_t capacity);
+
+/**
+ * @brief 清空缓存，统计信息不变
+ */
+void cache_clear();
+
+/**
+ * @brief 获取缓存的统计信息
+ *
+ * @param [out] stats 统计信息
+ */
+void cache_get_stats(cache_stats_t *stats);
+
+/**
+ * @brief 清零命中、未命中与淘汰的计数
+ */
+void cache_reset_stats();
+
+/**
+ * @brief 数牌花色的置换
+ *  万、条、饼三门数牌互换之后，上听数、听牌、打牌的结果只是相应地换了花色
+ *  cached_系列函数先将手牌置换为规范形式再查缓存，花色互换的手牌共用一个条目
+ */
+struct suit_permutation_t {
+    uint8_t to_canonical[3];    ///< 各门数牌（万、条、饼依次为0、1、2）置换后的下标
+    uint8_t from_canonical[3];  ///< 置换后的各门数牌原来的下标
+};
+
+/**
+ * @brief 查询的种类
+ */
+enum suit_query_t {
+    SUIT_QUERY_SHANTEN,  ///< 上听数、听牌、打牌
+    SUIT_QUERY_FAN       ///< 算番
+};
+
+/**
+ * @brief 花色置换对该查询是否安全
+ *  上听数、听牌、打牌总是安全的；算番时，手牌在某种花色分配下可能构成绿一色或推不倒的，不安全
+ *
+ * @param [in] query 查询的种类
+ * @param [in] hand_tiles 手牌
+ * @param [in] extra_tile 上牌或和牌张，没有时为0
+ * @return bool
+ */
+bool is_suit_permutation_safe(suit_query_t query, const hand_tiles_t *hand_tiles, tile_t extra_tile);
+
+/**
+ * @brief 将手牌置换为规范形式
+ *  按各门数牌的张数分布排序得到置换，花色互换的手牌得到相同的立牌
+ *  不检查输入的合法性，不合法的牌原样保留
+ *
+ * @param [in] hand_tiles 手牌
+ * @param [in] extra_tile 上牌或和牌张，没有时为0
+ * @param [out] canonical_hand 置换后的手牌
+ * @param [out] canonical_extra 置换后的上牌或和牌张
+ * @param [out] permutation 所用的置换
+ */
+void canonicalize_suits(const hand_tiles_t *hand_tiles, tile_t extra_tile,
+    hand_tiles_t *canonical_hand, tile_t *canonical_extra, suit_permutation_t *permutation);
+
+/**
+ * @brief 将规范形式中的一张牌还原为原来的牌
+ *
+ * @param [in] permutation 置换
+ * @param [in] tile 规范形式中的牌
+ * @return tile_t 原来的牌
+ */
+tile_t restore_suit_tile(const suit_permutation_t *permutation, tile_t tile);
+
+/**
+ * @brief 将规范形式的有效牌表还原为原来花色的有效牌表
+ *
+ * @param [in] permutation 置换
+ * @param [in,out] useful_table 有效牌表
+ */
+void restore_suit_useful_table(const suit_permutation_t *permutation, useful_table_t *useful_table);
+
+/**
+ * @brief 带缓存的基本和型上听数
+ * @see basic_form_shanten
+ */
+int cached_basic_form_shanten(const tile_t *standing_tiles, intptr_t standing_cnt, useful_table_t *useful_table);
+
+/**
+ * @brief 带缓存的是否听牌
+ * @see is_waiting
+ */
+bool cached_is_waiting(const hand_tiles_t &hand_tiles, useful_table_t *useful_table);
+
+/**
+ * @brief 带缓存的批量计算打每一张牌的结果
+ * @see evaluate_all_discards
+ */
+intptr_t cached_evaluate_all_discards(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag, enum_result_t *results);
+
+/**
+ * @brief 带缓存的枚举打哪张牌
+ * @see enum_discard_tile
+ */
+void cached_enum_discard_tile(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag,
+    void *context, enum_callback_t enum_callback);
+
+/**
+ * @brief 带缓存的算番
+ * @see calculate_fan
+ */
+int cached_calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_table);
+
+/**
+ * end group
+ * @}
+ */
+
+}
+
+#endif
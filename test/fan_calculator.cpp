@@ -59,6 +59,7 @@
  */
 
 #define MAX_DIVISION_CNT 20  // 一副牌最多也没有20种划分吧，够用了
+#define MAX_SUIT_DIVISION_CNT 16  // 一门花色的划分数，清一色也不会超过这么多
 
 #if 0
 #define LOG(fmt_, ...) printf(fmt_, ##__VA_ARGS__)
@@ -88,126 +89,158 @@ namespace {
         division_t divisions[MAX_DIVISION_CNT];  // 每一种划分
         intptr_t count;  // 划分方式总数
     };
-}
 
-// 递归划分算法的最后一步，添加划分
-static void divide_tail_add_division(intptr_t fixed_cnt, const division_t *work_division, division_result_t *result) {
-    // 拷贝一份当前的划分出来的面子，并排序暗手的面子
-    // 这里不能直接在work_division->packs上排序，否则会破坏递归外层的数据
-    division_t temp;
-    memcpy(&temp, work_division, sizeof(temp));
-    std::sort(temp.packs + fixed_cnt, temp.packs + 4);
+    // 一门花色的划分
+    struct suit_division_t {
+        pack_t packs[4];  // 面子
+        intptr_t pack_cnt;  // 面子数
+        tile_t pair_tile;  // 雀头，没有雀头时为0
+    };
 
-    // 如果这种划分是否已经存在了
-    if (std::none_of(&result->divisions[0], &result->divisions[result->count],
-        [&temp, fixed_cnt](const division_t &od) {
-        return std::equal(&od.packs[fixed_cnt], &od.packs[4], &temp.packs[fixed_cnt]);
-    })) {
-        // 写入划分结果里
-        memcpy(&result->divisions[result->count], &temp, sizeof(temp));
-        ++result->count;
-    }
-    else {
-        LOG("same case");
-    }
+    // 一门花色的划分结果
+    struct suit_division_result_t {
+        suit_division_t divisions[MAX_SUIT_DIVISION_CNT];  // 每一种划分
+        intptr_t count;  // 划分方式总数
+    };
 }
 
-// 递归划分的最后一步
-static bool divide_tail(tile_table_t &cnt_table, intptr_t fixed_cnt, division_t *work_division, division_result_t *result) {
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 2) {
-            continue;
-        }
+// 划分同一张牌时各种牌组的先后顺序，同一张牌只能按此顺序依次取，从而每种划分只会得到一次
+#define SUIT_DIVISION_STEP_PUNG 0  // 刻子
+#define SUIT_DIVISION_STEP_CHOW 1  // 顺子
+#define SUIT_DIVISION_STEP_PAIR 2  // 雀头
 
-        cnt_table[t] -= 2;  // 削减
-        // 所有牌全部使用完毕
-        if (std::all_of(std::begin(cnt_table), std::end(cnt_table), [](int n) { return n == 0; })) {
-            cnt_table[t] += 2;  // 还原
-
-            // 这2张作为雀头
-            work_division->packs[4] = make_pack(0, PACK_TYPE_PAIR, t);
-            divide_tail_add_division(fixed_cnt, work_division, result);  // 记录
-            return true;
+// 递归划分一门花色
+// 每一步都取当前最小的牌，它只能是刻子、顺子或者雀头的第一张，所以不需要回头检查是否重复
+// t为当前最小的牌，step为这张牌下一步最早可以取的牌组，left_cnt为这门花色剩余的张数
+static void divide_suit_recursively(tile_table_t &cnt_table, tile_t t, int step, intptr_t left_cnt,
+    suit_division_t *work_division, suit_division_result_t *result) {
+    if (left_cnt == 0) {  // 全部划分完毕，记录
+        if (result->count < MAX_SUIT_DIVISION_CNT) {
+            memcpy(&result->divisions[result->count++], work_division, sizeof(suit_division_t));
         }
-        cnt_table[t] += 2;  // 还原
+        return;
     }
 
-    return false;
-}
+    // 跳到当前最小的牌
+    while (cnt_table[t] == 0) {
+        ++t;
+        step = SUIT_DIVISION_STEP_PUNG;
+    }
 
-// 判断一条划分分支是否来过
-static bool is_division_branch_exist(intptr_t fixed_cnt, intptr_t step, const division_t *work_division, const division_result_t *result) {
-    // 没有划分时，以及划分步骤小于3时，不检测，因为至少要有3步递归才会产生不同划分
-    if (result->count <= 0 || step < 3) {
-        return false;
+    // 刻子
+    if (step <= SUIT_DIVISION_STEP_PUNG && cnt_table[t] > 2) {
+        work_division->packs[work_division->pack_cnt++] = make_pack(0, PACK_TYPE_PUNG, t);
+        cnt_table[t] -= 3;
+        divide_suit_recursively(cnt_table, t, SUIT_DIVISION_STEP_CHOW, left_cnt - 3, work_division, result);
+        cnt_table[t] += 3;
+        --work_division->pack_cnt;
     }
 
-    // std::includes要求有序
-    // 这里不能直接在work_division->packs上排序，否则会破坏递归外层的数据
-    division_t temp;
-    memcpy(&temp.packs[fixed_cnt], &work_division->packs[fixed_cnt], step * sizeof(pack_t));
-    std::sort(&temp.packs[fixed_cnt], &temp.packs[fixed_cnt + step]);
+    // 顺子（只能是数牌），可以连续取多组
+    if (step <= SUIT_DIVISION_STEP_CHOW && is_numbered_suit_quick(t) && tile_get_rank(t) < 8 && cnt_table[t + 1] && cnt_table[t + 2]) {
+        work_division->packs[work_division->pack_cnt++] = make_pack(0, PACK_TYPE_CHOW, static_cast<tile_t>(t + 1));
+        --cnt_table[t];
+        --cnt_table[t + 1];
+        --cnt_table[t + 2];
+        divide_suit_recursively(cnt_table, t, SUIT_DIVISION_STEP_CHOW, left_cnt - 3, work_division, result);
+        ++cnt_table[t];
+        ++cnt_table[t + 1];
+        ++cnt_table[t + 2];
+        --work_division->pack_cnt;
+    }
 
-    // 只需要比较面子是否重复分支，雀头不参与比较，所以下标是4
-    return std::any_of(&result->divisions[0], &result->divisions[result->count],
-        [&temp, fixed_cnt, step](const division_t &od) {
-        return std::includes(&od.packs[fixed_cnt], &od.packs[4], &temp.packs[fixed_cnt], &temp.packs[fixed_cnt + step]);
-    });
+    // 雀头，只能有一个，并且剩余张数要是3n+2
+    if (cnt_table[t] > 1 && work_division->pair_tile == 0 && left_cnt % 3 == 2) {
+        work_division->pair_tile = t;
+        cnt_table[t] -= 2;
+        divide_suit_recursively(cnt_table, t, SUIT_DIVISION_STEP_PAIR, left_cnt - 2, work_division, result);
+        cnt_table[t] += 2;
+        work_division->pair_tile = 0;
+    }
 }
 
-// 递归划分
-static bool divide_recursively(tile_table_t &cnt_table, intptr_t fixed_cnt, intptr_t step, division_t *work_division, division_result_t *result) {
-    const intptr_t idx = step + fixed_cnt;
-    if (idx == 4) {  // 4组面子都有了
-        return divide_tail(cnt_table, fixed_cnt, work_division, result);
+// 划分一门花色
+static void divide_suit(tile_table_t &cnt_table, suit_t suit, intptr_t suit_cnt, suit_division_result_t *result) {
+    result->count = 0;
+    suit_division_t work_division;
+    work_division.pack_cnt = 0;
+    work_division.pair_tile = 0;
+    divide_suit_recursively(cnt_table, make_tile(suit, 1), SUIT_DIVISION_STEP_PUNG, suit_cnt, &work_division, result);
+}
+
+// 统计一门花色的张数
+static intptr_t count_suit_tiles(const tile_table_t &cnt_table, suit_t suit) {
+    const uint16_t *cnt = &cnt_table[make_tile(suit, 1)];
+    const int rank_cnt = (suit == TILE_SUIT_HONORS) ? 7 : 9;
+    intptr_t ret = 0;
+    for (int r = 0; r < rank_cnt; ++r) {
+        ret += cnt[r];
     }
+    return ret;
+}
 
-    bool ret = false;
+// 各门花色的张数是否可能划分：雀头所在的花色张数为3n+2，其余花色为3n
+static bool is_suit_counts_dividable(const intptr_t (&suit_cnt)[4]) {
+    int pair_suit_cnt = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (suit_cnt[i] % 3 == 1) {
+            return false;
+        }
+        if (suit_cnt[i] % 3 == 2) {
+            ++pair_suit_cnt;
+        }
+    }
+    return pair_suit_cnt == 1;
+}
 
-    // 按牌表张遍历牌
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (cnt_table[t] < 1) {
-            continue;
+// 组合各门花色的划分
+static void combine_suit_divisions(const suit_division_result_t *const (&suit_results)[4], intptr_t fixed_cnt, int suit_idx,
+    division_t *work_division, intptr_t pack_idx, division_result_t *result) {
+    if (suit_idx == 4) {  // 各门花色都选好了，记录
+        if (result->count < MAX_DIVISION_CNT) {
+            division_t *division = &result->divisions[result->count++];
+            memcpy(division, work_division, sizeof(*division));
+            std::sort(division->packs + fixed_cnt, division->packs + 4);
         }
+        return;
+    }
 
-        // 刻子
-        if (cnt_table[t] > 2) {
-            work_division->packs[idx] = make_pack(0, PACK_TYPE_PUNG, t);  // 记录刻子
-            if (!is_division_branch_exist(fixed_cnt, step + 1, work_division, result)) {
-                // 削减这组刻子，递归
-                cnt_table[t] -= 3;
-                if (divide_recursively(cnt_table, fixed_cnt, step + 1, work_division, result)) {
-                    ret = true;
-                }
-                // 还原
-                cnt_table[t] += 3;
-            }
+    const suit_division_result_t *suit_result = suit_results[suit_idx];
+    for (intptr_t i = 0; i < suit_result->count; ++i) {
+        const suit_division_t &suit_division = suit_result->divisions[i];
+        memcpy(&work_division->packs[pack_idx], suit_division.packs, suit_division.pack_cnt * sizeof(pack_t));
+        if (suit_division.pair_tile != 0) {
+            work_division->packs[4] = make_pack(0, PACK_TYPE_PAIR, suit_division.pair_tile);
         }
+        combine_suit_divisions(suit_results, fixed_cnt, suit_idx + 1, work_division, pack_idx + suit_division.pack_cnt, result);
+    }
+}
 
-        // 顺子（只能是数牌）
-        if (is_numbered_suit(t)) {
-            if (tile_get_rank(t) < 8 && cnt_table[t + 1] && cnt_table[t + 2]) {
-                work_division->packs[idx] = make_pack(0, PACK_TYPE_CHOW, static_cast<tile_t>(t + 1));  // 记录顺子
-                if (!is_division_branch_exist(fixed_cnt, step + 1, work_division, result)) {
-                    // 削减这组顺子，递归
-                    --cnt_table[t];
-                    --cnt_table[t + 1];
-                    --cnt_table[t + 2];
-                    if (divide_recursively(cnt_table, fixed_cnt, step + 1, work_division, result)) {
-                        ret = true;
-                    }
-                    // 还原
-                    ++cnt_table[t];
-                    ++cnt_table[t + 1];
-                    ++cnt_table[t + 2];
-                }
-            }
+// 按基本和型划分牌表中的牌，work_division的前fixed_cnt组为已经确定的面子
+// 先分别划分各门花色，再组合起来
+static bool divide_tiles(tile_table_t &cnt_table, intptr_t fixed_cnt, division_t *work_division, division_result_t *result) {
+    result->count = 0;
+
+    intptr_t suit_cnt[4];
+    for (int i = 0; i < 4; ++i) {
+        suit_cnt[i] = count_suit_tiles(cnt_table, static_cast<suit_t>(TILE_SUIT_CHARACTERS + i));
+    }
+    if (!is_suit_counts_dividable(suit_cnt)) {
+        return false;
+    }
+
+    suit_division_result_t suit_results[4];
+    const suit_division_result_t *suit_result_ptrs[4];
+    for (int i = 0; i < 4; ++i) {
+        divide_suit(cnt_table, static_cast<suit_t>(TILE_SUIT_CHARACTERS + i), suit_cnt[i], &suit_results[i]);
+        if (suit_results[i].count == 0) {
+            return false;
         }
+        suit_result_ptrs[i] = &suit_results[i];
     }
 
-    return ret;
+    combine_suit_divisions(suit_result_ptrs, fixed_cnt, 0, work_division, fixed_cnt, result);
+    return result->count > 0;
 }
 
 // 划分一手牌
@@ -218,12 +251,10 @@ static bool divide_win_hand(const tile_t *standing_tiles, const pack_t *fixed_pa
     tile_table_t cnt_table;
     map_tiles(standing_tiles, standing_cnt, &cnt_table);
 
-    result->count = 0;
-
     // 复制副露的面子
     division_t work_division;
     memcpy(work_division.packs, fixed_packs, fixed_cnt * sizeof(pack_t));
-    return divide_recursively(cnt_table, fixed_cnt, 0, &work_division, result);
+    return divide_tiles(cnt_table, fixed_cnt, &work_division, result);
 }
 
 //-------------------------------- 算番 --------------------------------
@@ -446,31 +477,101 @@ static fan_t get_1_pung_fan(tile_t mid_tile) {
     return FAN_NONE;
 }
 
-// 存在3组顺子的番种时，余下的第4组顺子最多算1番
-static fan_t get_1_chow_extra_fan(tile_t tile0, tile_t tile1, tile_t tile2, tile_t tile_extra) {
-    fan_t fan0 = get_2_chows_fan_unordered(tile0, tile_extra);
-    fan_t fan1 = get_2_chows_fan_unordered(tile1, tile_extra);
-    fan_t fan2 = get_2_chows_fan_unordered(tile2, tile_extra);
+//-------------------------------- 组合番表 --------------------------------
 
-    // 按以下顺序返回
-    // 一般高
-    if (fan0 == PURE_DOUBLE_CHOW || fan1 == PURE_DOUBLE_CHOW || fan2 == PURE_DOUBLE_CHOW) {
-        return PURE_DOUBLE_CHOW;
-    }
-    // 喜相逢
-    if (fan0 == MIXED_DOUBLE_CHOW || fan1 == MIXED_DOUBLE_CHOW || fan2 == MIXED_DOUBLE_CHOW) {
-        return MIXED_DOUBLE_CHOW;
+#define CHOW_INDEX_CNT 21  // 顺子中间牌的种数：3门数牌，每门2~8
+#define PUNG_INDEX_CNT 34  // 刻子的种数
+
+// 顺子中间牌的稠密下标
+static FORCE_INLINE int chow_get_index(tile_t mid_tile) {
+    return (tile_get_suit(mid_tile) - 1) * 7 + tile_get_rank(mid_tile) - 2;
+}
+
+// 刻子的稠密下标
+static FORCE_INLINE int pung_get_index(tile_t mid_tile) {
+    return tile_get_index(mid_tile);
+}
+
+// 存在3组顺子的番种时，余下的第4组顺子最多算1番，按优先级从低到高排列
+static const fan_t chow_extra_fans[] = { FAN_NONE, TWO_TERMINAL_CHOWS, SHORT_STRAIGHT, MIXED_DOUBLE_CHOW, PURE_DOUBLE_CHOW };
+
+namespace {
+
+    // 组合番表，以各组面子中间牌的稠密下标为索引，值为番种
+    // 4组面子的番种只需几次比较，且表太大，不打表
+    struct combination_fan_table_t {
+        uint8_t chows_2[CHOW_INDEX_CNT][CHOW_INDEX_CNT];
+        uint8_t chows_3[CHOW_INDEX_CNT][CHOW_INDEX_CNT][CHOW_INDEX_CNT];
+        uint8_t chow_extra[CHOW_INDEX_CNT][CHOW_INDEX_CNT];  // 值为番种在chow_extra_fans中的优先级
+        uint8_t pungs_2[PUNG_INDEX_CNT][PUNG_INDEX_CNT];
+        uint8_t pungs_3[PUNG_INDEX_CNT][PUNG_INDEX_CNT][PUNG_INDEX_CNT];
+
+        combination_fan_table_t();
+    };
+}
+
+combination_fan_table_t::combination_fan_table_t() {
+    tile_t chow_tiles[CHOW_INDEX_CNT];
+    for (int i = 0; i < CHOW_INDEX_CNT; ++i) {
+        chow_tiles[i] = make_tile(i / 7 + 1, i % 7 + 2);
     }
-    // 连六
-    if (fan0 == SHORT_STRAIGHT || fan1 == SHORT_STRAIGHT || fan2 == SHORT_STRAIGHT) {
-        return SHORT_STRAIGHT;
+
+    for (int i = 0; i < CHOW_INDEX_CNT; ++i) {
+        for (int j = 0; j < CHOW_INDEX_CNT; ++j) {
+            fan_t fan = get_2_chows_fan_unordered(chow_tiles[i], chow_tiles[j]);
+            chows_2[i][j] = static_cast<uint8_t>(fan);
+            chow_extra[i][j] = 0;
+            for (uint8_t priority = 1; priority < sizeof(chow_extra_fans) / sizeof(chow_extra_fans[0]); ++priority) {
+                if (chow_extra_fans[priority] == fan) {
+                    chow_extra[i][j] = priority;
+                }
+            }
+            for (int k = 0; k < CHOW_INDEX_CNT; ++k) {
+                chows_3[i][j][k] = static_cast<uint8_t>(get_3_chows_fan(chow_tiles[i], chow_tiles[j], chow_tiles[k]));
+            }
+        }
     }
-    // 老少副
-    if (fan0 == TWO_TERMINAL_CHOWS || fan1 == TWO_TERMINAL_CHOWS || fan2 == TWO_TERMINAL_CHOWS) {
-        return TWO_TERMINAL_CHOWS;
+
+    for (int i = 0; i < PUNG_INDEX_CNT; ++i) {
+        for (int j = 0; j < PUNG_INDEX_CNT; ++j) {
+            pungs_2[i][j] = static_cast<uint8_t>(get_2_pungs_fan_unordered(all_tiles[i], all_tiles[j]));
+            for (int k = 0; k < PUNG_INDEX_CNT; ++k) {
+                pungs_3[i][j][k] = static_cast<uint8_t>(get_3_pungs_fan(all_tiles[i], all_tiles[j], all_tiles[k]));
+            }
+        }
     }
+}
 
-    return FAN_NONE;
+// 获取组合番表，首次使用时构建
+static const combination_fan_table_t &get_combination_fan_table() {
+    static const combination_fan_table_t table;
+    return table;
+}
+
+// 查表：2组顺子的番
+static FORCE_INLINE fan_t lookup_2_chows_fan(const combination_fan_table_t &table, int idx0, int idx1) {
+    return static_cast<fan_t>(table.chows_2[idx0][idx1]);
+}
+
+// 查表：3组顺子的番
+static FORCE_INLINE fan_t lookup_3_chows_fan(const combination_fan_table_t &table, int idx0, int idx1, int idx2) {
+    return static_cast<fan_t>(table.chows_3[idx0][idx1][idx2]);
+}
+
+// 查表：存在3组顺子的番种时，余下的第4组顺子最多算1番
+static FORCE_INLINE fan_t lookup_1_chow_extra_fan(const combination_fan_table_t &table, int idx0, int idx1, int idx2, int idx_extra) {
+    uint8_t priority = std::max(std::max(table.chow_extra[idx0][idx_extra], table.chow_extra[idx1][idx_extra]), table.chow_extra[idx2][idx_extra]);
+    return chow_extra_fans[priority];
+}
+
+// 查表：2组刻子的番
+static FORCE_INLINE fan_t lookup_2_pungs_fan(const combination_fan_table_t &table, int idx0, int idx1) {
+    return static_cast<fan_t>(table.pungs_2[idx0][idx1]);
+}
+
+// 查表：3组刻子的番
+static FORCE_INLINE fan_t lookup_3_pungs_fan(const combination_fan_table_t &table, int idx0, int idx1, int idx2) {
+    return static_cast<fan_t>(table.pungs_3[idx0][idx1][idx2]);
 }
 
 // 套算一次原则：
@@ -524,39 +625,42 @@ static void calculate_4_chows(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
         return;
     }
 
+    const combination_fan_table_t &table = get_combination_fan_table();
+    const int idx[4] = { chow_get_index(mid_tiles[0]), chow_get_index(mid_tiles[1]), chow_get_index(mid_tiles[2]), chow_get_index(mid_tiles[3]) };
+
     // 3组顺子判断
     // 012构成3组顺子的番种
-    if ((fan = get_3_chows_fan(mid_tiles[0], mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_3_chows_fan(table, idx[0], idx[1], idx[2])) != FAN_NONE) {
         fan_table[fan] = 1;
         // 计算与第4组顺子构成的番
-        if ((fan = get_1_chow_extra_fan(mid_tiles[0], mid_tiles[1], mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+        if ((fan = lookup_1_chow_extra_fan(table, idx[0], idx[1], idx[2], idx[3])) != FAN_NONE) {
             fan_table[fan] = 1;
         }
         return;
     }
     // 013构成3组顺子的番种
-    else if ((fan = get_3_chows_fan(mid_tiles[0], mid_tiles[1], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_chows_fan(table, idx[0], idx[1], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         // 计算与第4组顺子构成的番
-        if ((fan = get_1_chow_extra_fan(mid_tiles[0], mid_tiles[1], mid_tiles[3], mid_tiles[2])) != FAN_NONE) {
+        if ((fan = lookup_1_chow_extra_fan(table, idx[0], idx[1], idx[3], idx[2])) != FAN_NONE) {
             fan_table[fan] = 1;
         }
         return;
     }
     // 023构成3组顺子的番种
-    else if ((fan = get_3_chows_fan(mid_tiles[0], mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_chows_fan(table, idx[0], idx[2], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         // 计算与第4组顺子构成的番
-        if ((fan = get_1_chow_extra_fan(mid_tiles[0], mid_tiles[2], mid_tiles[3], mid_tiles[1])) != FAN_NONE) {
+        if ((fan = lookup_1_chow_extra_fan(table, idx[0], idx[2], idx[3], idx[1])) != FAN_NONE) {
             fan_table[fan] = 1;
         }
         return;
     }
     // 123构成3组顺子的番种
-    else if ((fan = get_3_chows_fan(mid_tiles[1], mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_chows_fan(table, idx[1], idx[2], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         // 计算与第4组顺子构成的番
-        if ((fan = get_1_chow_extra_fan(mid_tiles[1], mid_tiles[2], mid_tiles[3], mid_tiles[0])) != FAN_NONE) {
+        if ((fan = lookup_1_chow_extra_fan(table, idx[1], idx[2], idx[3], idx[0])) != FAN_NONE) {
             fan_table[fan] = 1;
         }
         return;
@@ -564,12 +668,12 @@ static void calculate_4_chows(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
 
     // 不存在3组顺子的番种时，4组顺子最多3番
     fan_t all_fans[6] = {
-        get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[1]),
-        get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[2]),
-        get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[3]),
-        get_2_chows_fan_unordered(mid_tiles[1], mid_tiles[2]),
-        get_2_chows_fan_unordered(mid_tiles[1], mid_tiles[3]),
-        get_2_chows_fan_unordered(mid_tiles[2], mid_tiles[3])
+        lookup_2_chows_fan(table, idx[0], idx[1]),
+        lookup_2_chows_fan(table, idx[0], idx[2]),
+        lookup_2_chows_fan(table, idx[0], idx[3]),
+        lookup_2_chows_fan(table, idx[1], idx[2]),
+        lookup_2_chows_fan(table, idx[1], idx[3]),
+        lookup_2_chows_fan(table, idx[2], idx[3])
     };
 
     int max_cnt = 3;
@@ -603,17 +707,20 @@ static void calculate_4_chows(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
 static void calculate_3_chows(const tile_t (&mid_tiles)[3], fan_table_t &fan_table) {
     fan_t fan;
 
+    const combination_fan_table_t &table = get_combination_fan_table();
+    const int idx[3] = { chow_get_index(mid_tiles[0]), chow_get_index(mid_tiles[1]), chow_get_index(mid_tiles[2]) };
+
     // 存在3组顺子的番种时，不再检测其他的
-    if ((fan = get_3_chows_fan(mid_tiles[0], mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_3_chows_fan(table, idx[0], idx[1], idx[2])) != FAN_NONE) {
         fan_table[fan] = 1;
         return;
     }
 
     // 不存在上述番种时，3组顺子最多2番
     fan_t all_fans[3] = {
-        get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[1]),
-        get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[2]),
-        get_2_chows_fan_unordered(mid_tiles[1], mid_tiles[2])
+        lookup_2_chows_fan(table, idx[0], idx[1]),
+        lookup_2_chows_fan(table, idx[0], idx[2]),
+        lookup_2_chows_fan(table, idx[1], idx[2])
     };
     exclusionary_rule(all_fans, 3, 2, fan_table);
 }
@@ -621,7 +728,7 @@ static void calculate_3_chows(const tile_t (&mid_tiles)[3], fan_table_t &fan_tab
 // 2组顺子算番
 static void calculate_2_chows_unordered(const tile_t (&mid_tiles)[2], fan_table_t &fan_table) {
     fan_t fan;
-    if ((fan = get_2_chows_fan_unordered(mid_tiles[0], mid_tiles[1])) != FAN_NONE) {
+    if ((fan = lookup_2_chows_fan(get_combination_fan_table(), chow_get_index(mid_tiles[0]), chow_get_index(mid_tiles[1]))) != FAN_NONE) {
         ++fan_table[fan];
     }
 }
@@ -795,29 +902,32 @@ static void calculate_4_pungs(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
         return;
     }
 
+    const combination_fan_table_t &table = get_combination_fan_table();
+    const int idx[4] = { pung_get_index(mid_tiles[0]), pung_get_index(mid_tiles[1]), pung_get_index(mid_tiles[2]), pung_get_index(mid_tiles[3]) };
+
     // 3组刻子判断
     bool _3_pungs_has_fan = false;
     int free_pack_idx = -1;  // 未使用的1组刻子
     // 012构成3组刻子的番种
-    if ((fan = get_3_pungs_fan(mid_tiles[0], mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_3_pungs_fan(table, idx[0], idx[1], idx[2])) != FAN_NONE) {
         fan_table[fan] = 1;
         free_pack_idx = 3;
         _3_pungs_has_fan = true;
     }
     // 013构成3组刻子的番种
-    else if ((fan = get_3_pungs_fan(mid_tiles[0], mid_tiles[1], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_pungs_fan(table, idx[0], idx[1], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         free_pack_idx = 2;
         _3_pungs_has_fan = true;
     }
     // 023构成3组刻子的番种
-    else if ((fan = get_3_pungs_fan(mid_tiles[0], mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_pungs_fan(table, idx[0], idx[2], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         free_pack_idx = 1;
         _3_pungs_has_fan = true;
     }
     // 123构成3组刻子的番种
-    else if ((fan = get_3_pungs_fan(mid_tiles[1], mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+    else if ((fan = lookup_3_pungs_fan(table, idx[1], idx[2], idx[3])) != FAN_NONE) {
         fan_table[fan] = 1;
         free_pack_idx = 0;
         _3_pungs_has_fan = true;
@@ -830,7 +940,7 @@ static void calculate_4_pungs(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
                 continue;
             }
             // 依次与未使用的这组刻子测试番种
-            if ((fan = get_2_pungs_fan_unordered(mid_tiles[i], mid_tiles[free_pack_idx])) != FAN_NONE) {
+            if ((fan = lookup_2_pungs_fan(table, idx[i], idx[free_pack_idx])) != FAN_NONE) {
                 ++fan_table[fan];
                 break;
             }
@@ -839,22 +949,22 @@ static void calculate_4_pungs(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
     }
 
     // 不存在3组刻子的番种时，两两计算番种
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[1])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[0], idx[1])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[0], idx[2])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[3])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[0], idx[3])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[1], idx[2])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[1], mid_tiles[3])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[1], idx[3])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[2], mid_tiles[3])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[2], idx[3])) != FAN_NONE) {
         ++fan_table[fan];
     }
 }
@@ -863,27 +973,30 @@ static void calculate_4_pungs(const tile_t (&mid_tiles)[4], fan_table_t &fan_tab
 static void calculate_3_pungs(const tile_t (&mid_tiles)[3], fan_table_t &fan_table) {
     fan_t fan;
 
+    const combination_fan_table_t &table = get_combination_fan_table();
+    const int idx[3] = { pung_get_index(mid_tiles[0]), pung_get_index(mid_tiles[1]), pung_get_index(mid_tiles[2]) };
+
     // 存在3组刻子的番种（三节高 三同刻 三风刻 大三元）时，不再检测其他的
-    if ((fan = get_3_pungs_fan(mid_tiles[0], mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_3_pungs_fan(table, idx[0], idx[1], idx[2])) != FAN_NONE) {
         fan_table[fan] = 1;
         return;
     }
 
     // 不存在3组刻子的番种时，两两计算番种
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[1])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[0], idx[1])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[0], idx[2])) != FAN_NONE) {
         ++fan_table[fan];
     }
-    if ((fan = get_2_pungs_fan_unordered(mid_tiles[1], mid_tiles[2])) != FAN_NONE) {
+    if ((fan = lookup_2_pungs_fan(table, idx[1], idx[2])) != FAN_NONE) {
         ++fan_table[fan];
     }
 }
 
 // 2组刻子算番
 static void calculate_2_pungs_unordered(const tile_t (&mid_tiles)[2], fan_table_t &fan_table) {
-    fan_t fan = get_2_pungs_fan_unordered(mid_tiles[0], mid_tiles[1]);
+    fan_t fan = lookup_2_pungs_fan(get_combination_fan_table(), pung_get_index(mid_tiles[0]), pung_get_index(mid_tiles[1]));
     if (fan != FAN_NONE) {
         ++fan_table[fan];
     }
@@ -956,8 +1069,15 @@ static bool is_three_suited_terminal_chows(const pack_t (&chow_packs)[4], pack_t
 }
 
 // 根据和牌方式调整——涉及番种：不求人、全求人
-static void adjust_by_self_drawn(const pack_t (&packs)[5], intptr_t fixed_cnt, bool self_drawn, fan_table_t &fan_table) {
-    ptrdiff_t melded_cnt = std::count_if(&packs[0], &packs[fixed_cnt], &is_pack_melded);  // 明副露的组数
+// 副露组数FixedCnt为模板参数，统计明副露的循环在编译时展开
+template <intptr_t FixedCnt>
+static void adjust_by_self_drawn(const pack_t (&packs)[5], bool self_drawn, fan_table_t &fan_table) {
+    intptr_t melded_cnt = 0;  // 明副露的组数
+    for (intptr_t i = 0; i < FixedCnt; ++i) {
+        if (is_pack_melded(packs[i])) {
+            ++melded_cnt;
+        }
+    }
 
     switch (melded_cnt) {
     case 0:  // 0组明的，自摸为不求人，点和为门前清
@@ -1184,35 +1304,29 @@ static void adjust_by_tiles_hog(const tile_t *tiles, intptr_t tile_cnt, fan_tabl
     fan_table[TILE_HOG] = static_cast<uint8_t>(_4_cnt - kong_cnt);
 }
 
-// 根据听牌方式调整——涉及番种：边张、嵌张、单钓将
-static void adjust_by_waiting_form(const pack_t *concealed_packs, intptr_t pack_cnt, const tile_t *standing_tiles, intptr_t standing_cnt,
-    tile_t win_tile, fan_table_t &fan_table) {
-    // 全求人和四杠不计单钓将，也不可能有边张、嵌张
-    if (fan_table[MELDED_HAND] || fan_table[FOUR_KONGS]) {
-        return;
-    }
-
+// 判断是否只听1张，听牌数大于1张，不计边张、嵌张、单钓将
+static bool is_single_wait(const tile_t *standing_tiles, intptr_t standing_cnt, intptr_t pack_cnt) {
     useful_table_t waiting_table;  // 听牌标记表
     if (!is_basic_form_wait(standing_tiles, standing_cnt, &waiting_table)) {
-        return;
+        return false;
     }
+    tile_set_t waiting_set = useful_table_to_tile_set(waiting_table);
 
     if (pack_cnt == 5) {  // 门清状态
         // 判断是否为七对听牌
         useful_table_t temp_table;
         if (is_seven_pairs_wait(standing_tiles, standing_cnt, &temp_table)) {
-            // 合并听牌标记表
-            std::transform(std::begin(temp_table), std::end(temp_table), std::begin(waiting_table),
-                std::begin(waiting_table), [](bool w, bool t) { return w || t; });
+            // 合并听牌
+            waiting_set = tile_set_union(waiting_set, useful_table_to_tile_set(temp_table));
         }
     }
 
-    // 统计听牌张数，听牌数大于1张，不计边张、嵌张、单钓将
-    if (1 != std::count(std::begin(waiting_table), std::end(waiting_table), true)) {
-        return;
-    }
+    // 统计听牌张数
+    return 1 == tile_set_count(waiting_set);
+}
 
-    // 听1张的情况，看和牌张处于什么位置
+// 根据和牌张所处的位置调整——涉及番种：边张、嵌张、单钓将
+static void adjust_by_win_tile_position(const pack_t *concealed_packs, intptr_t pack_cnt, tile_t win_tile, fan_table_t &fan_table) {
     // 边张0x01 嵌张0x02 单钓将0x04
     uint8_t pos_flag = 0;
 
@@ -1252,290 +1366,214 @@ static void adjust_by_waiting_form(const pack_t *concealed_packs, intptr_t pack_
     }
 }
 
-// 统一调整一些不计的
-static void adjust_fan_table(fan_table_t &fan_table) {
-    // 大四喜不计三风刻、碰碰和、圈风刻、门风刻、幺九刻
-    if (fan_table[BIG_FOUR_WINDS]) {
-        fan_table[BIG_THREE_WINDS] = 0;
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[PUNG_OF_TERMINALS_OR_HONORS] = 0;
+// 根据听牌方式调整——涉及番种：边张、嵌张、单钓将
+static void adjust_by_waiting_form(const pack_t *concealed_packs, intptr_t pack_cnt, const tile_t *standing_tiles, intptr_t standing_cnt,
+    tile_t win_tile, fan_table_t &fan_table) {
+    // 全求人和四杠不计单钓将，也不可能有边张、嵌张
+    if (fan_table[MELDED_HAND] || fan_table[FOUR_KONGS]) {
+        return;
     }
-    // 大三元不计双箭刻、箭刻（严格98规则不计缺一门）
-    if (fan_table[BIG_THREE_DRAGONS]) {
-        fan_table[TWO_DRAGONS_PUNGS] = 0;
-        fan_table[DRAGON_PUNG] = 0;
+
+    // 听1张的情况，看和牌张处于什么位置
+    if (is_single_wait(standing_tiles, standing_cnt, pack_cnt)) {
+        adjust_by_win_tile_position(concealed_packs, pack_cnt, win_tile, fan_table);
+    }
+}
+
+namespace {
+
+    // 番种集合，第i位表示番种i
+    struct fan_set_t {
+        uint64_t bits[2];
+    };
+
+    // 不计规则：存在番种fan时，不计excluded中的番种
+    struct exclusion_rule_t {
+        fan_t fan;
+        fan_set_t excluded;
+    };
+}
+
+// 构造番种集合的其中一个字，FAN_NONE不占位
+static constexpr uint64_t make_fan_set_word(int /* word */) {
+    return 0;
+}
+
+template <class... Fans>
+static constexpr uint64_t make_fan_set_word(int word, fan_t fan, Fans... fans) {
+    return (fan != FAN_NONE && (fan >> 6) == word ? 1ULL << (fan & 63) : 0) | make_fan_set_word(word, fans...);
+}
+
+// 构造番种集合
+template <class... Fans>
+static constexpr fan_set_t make_fan_set(Fans... fans) {
+    return fan_set_t{ { make_fan_set_word(0, fans...), make_fan_set_word(1, fans...) } };
+}
+
+// 严格98规则额外不计的番种，通行计法下为FAN_NONE
 #ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
+#define STRICT_98_ONE_VOIDED_SUIT ONE_VOIDED_SUIT
+#define STRICT_98_TRIPLE_PUNG TRIPLE_PUNG
+#else
+#define STRICT_98_ONE_VOIDED_SUIT FAN_NONE
+#define STRICT_98_TRIPLE_PUNG FAN_NONE
 #endif
-    }
+
+// 不计规则表
+// 按顺序应用：被前面规则不计掉的番种，其自身的规则不再生效
+// 九莲宝灯、四暗刻把不求人修正为自摸，由adjust_fan_table先行处理，这里只记不计不求人
+// 九莲宝灯减计幺九刻、三风刻扣除幺九刻是调整数量的，也由adjust_fan_table处理
+static constexpr exclusion_rule_t exclusion_rules[] = {
+    // 大四喜不计三风刻、碰碰和、圈风刻、门风刻、幺九刻
+    { BIG_FOUR_WINDS, make_fan_set(BIG_THREE_WINDS, ALL_PUNGS, PUNG_OF_TERMINALS_OR_HONORS) },
+    // 大三元不计双箭刻、箭刻（严格98规则不计缺一门）
+    { BIG_THREE_DRAGONS, make_fan_set(TWO_DRAGONS_PUNGS, DRAGON_PUNG, STRICT_98_ONE_VOIDED_SUIT) },
     // 绿一色不计混一色、缺一门
-    if (fan_table[ALL_GREEN]) {
-        fan_table[HALF_FLUSH] = 0;
-        fan_table[ONE_VOIDED_SUIT] = 0;
-    }
-    // 九莲宝灯不计清一色、门前清、缺一门、无字，减计1个幺九刻，把不求人修正为自摸
-    if (fan_table[NINE_GATES]) {
-        fan_table[FULL_FLUSH] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-        --fan_table[PUNG_OF_TERMINALS_OR_HONORS];
-        fan_table[ONE_VOIDED_SUIT] = 0;
-        fan_table[NO_HONORS] = 0;
-        if (fan_table[FULLY_CONCEALED_HAND]) {
-            fan_table[FULLY_CONCEALED_HAND] = 0;
-            fan_table[SELF_DRAWN] = 1;
-        }
-    }
+    { ALL_GREEN, make_fan_set(HALF_FLUSH, ONE_VOIDED_SUIT) },
+    // 九莲宝灯不计清一色、门前清、缺一门、无字、不求人
+    { NINE_GATES, make_fan_set(FULL_FLUSH, CONCEALED_HAND, ONE_VOIDED_SUIT, NO_HONORS, FULLY_CONCEALED_HAND) },
     // 四杠不计单钓将
-    if (fan_table[FOUR_KONGS]) {
-        fan_table[SINGLE_WAIT] = 0;
-    }
+    { FOUR_KONGS, make_fan_set(SINGLE_WAIT) },
     // 连七对不计七对、清一色、门前清、缺一门、无字
-    if (fan_table[SEVEN_SHIFTED_PAIRS]) {
-        fan_table[SEVEN_PAIRS] = 0;
-        fan_table[FULL_FLUSH] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-        fan_table[ONE_VOIDED_SUIT] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { SEVEN_SHIFTED_PAIRS, make_fan_set(SEVEN_PAIRS, FULL_FLUSH, CONCEALED_HAND, ONE_VOIDED_SUIT, NO_HONORS) },
     // 十三幺不计五门齐、门前清、单钓将
-    if (fan_table[THIRTEEN_ORPHANS]) {
-        fan_table[ALL_TYPES] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-        fan_table[SINGLE_WAIT] = 0;
-    }
-
-    // 清幺九不计混幺九、碰碰胡、全带幺、幺九刻、无字（严格98规则不计双同刻、不计三同刻）
-    if (fan_table[ALL_TERMINALS]) {
-        fan_table[ALL_TERMINALS_AND_HONORS] = 0;
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[OUTSIDE_HAND] = 0;
-        fan_table[PUNG_OF_TERMINALS_OR_HONORS] = 0;
-        fan_table[NO_HONORS] = 0;
-        fan_table[DOUBLE_PUNG] = 0;  // 通行计法不计双同刻
-#ifdef STRICT_98_RULE
-        fan_table[TRIPLE_PUNG] = 0;
-        fan_table[DOUBLE_PUNG] = 0;
-#endif
-    }
+    { THIRTEEN_ORPHANS, make_fan_set(ALL_TYPES, CONCEALED_HAND, SINGLE_WAIT) },
+
+    // 清幺九不计混幺九、碰碰胡、全带幺、幺九刻、无字、双同刻（通行计法不计双同刻，严格98规则不计双同刻、三同刻）
+    { ALL_TERMINALS, make_fan_set(ALL_TERMINALS_AND_HONORS, ALL_PUNGS, OUTSIDE_HAND, PUNG_OF_TERMINALS_OR_HONORS, NO_HONORS, DOUBLE_PUNG, STRICT_98_TRIPLE_PUNG) },
 
     // 小四喜不计三风刻
-    if (fan_table[LITTLE_FOUR_WINDS]) {
-        fan_table[BIG_THREE_WINDS] = 0;
-        // 小四喜的第四组牌如果是19的刻子，则是混幺九；如果是箭刻则是字一色；这两种都是不计幺九刻的
-        // 如果是顺子或者2-8的刻子，则不存在多余的幺九刻
-        // 所以这里将幺九刻置为0
-        fan_table[PUNG_OF_TERMINALS_OR_HONORS] = 0;
-    }
+    // 小四喜的第四组牌如果是19的刻子，则是混幺九；如果是箭刻则是字一色；这两种都是不计幺九刻的
+    // 如果是顺子或者2-8的刻子，则不存在多余的幺九刻
+    // 所以这里也不计幺九刻
+    { LITTLE_FOUR_WINDS, make_fan_set(BIG_THREE_WINDS, PUNG_OF_TERMINALS_OR_HONORS) },
 
     // 小三元不计双箭刻、箭刻（严格98规则不计缺一门）
-    if (fan_table[LITTLE_THREE_DRAGONS]) {
-        fan_table[TWO_DRAGONS_PUNGS] = 0;
-        fan_table[DRAGON_PUNG] = 0;
-#ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
-#endif
-    }
+    { LITTLE_THREE_DRAGONS, make_fan_set(TWO_DRAGONS_PUNGS, DRAGON_PUNG, STRICT_98_ONE_VOIDED_SUIT) },
 
     // 字一色不计混幺九、碰碰胡、全带幺、幺九刻、缺一门
-    if (fan_table[ALL_HONORS]) {
-        fan_table[ALL_TERMINALS_AND_HONORS] = 0;
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[OUTSIDE_HAND] = 0;
-        fan_table[PUNG_OF_TERMINALS_OR_HONORS] = 0;
-        fan_table[ONE_VOIDED_SUIT] = 0;
-    }
-    // 四暗刻不计碰碰和、门前清，把不求人修正为自摸
-    if (fan_table[FOUR_CONCEALED_PUNGS]) {
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-        if (fan_table[FULLY_CONCEALED_HAND]) {
-            fan_table[FULLY_CONCEALED_HAND] = 0;
-            fan_table[SELF_DRAWN] = 1;
-        }
-    }
+    { ALL_HONORS, make_fan_set(ALL_TERMINALS_AND_HONORS, ALL_PUNGS, OUTSIDE_HAND, PUNG_OF_TERMINALS_OR_HONORS, ONE_VOIDED_SUIT) },
+    // 四暗刻不计碰碰和、门前清、不求人
+    { FOUR_CONCEALED_PUNGS, make_fan_set(ALL_PUNGS, CONCEALED_HAND, FULLY_CONCEALED_HAND) },
     // 一色双龙会不计七对、清一色、平和、一般高、老少副、缺一门、无字
-    if (fan_table[PURE_TERMINAL_CHOWS]) {
-        fan_table[SEVEN_PAIRS] = 0;
-        fan_table[FULL_FLUSH] = 0;
-        fan_table[ALL_CHOWS] = 0;
-        fan_table[PURE_DOUBLE_CHOW] = 0;
-        fan_table[TWO_TERMINAL_CHOWS] = 0;
-        fan_table[ONE_VOIDED_SUIT] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { PURE_TERMINAL_CHOWS, make_fan_set(SEVEN_PAIRS, FULL_FLUSH, ALL_CHOWS, PURE_DOUBLE_CHOW, TWO_TERMINAL_CHOWS, ONE_VOIDED_SUIT, NO_HONORS) },
 
     // 一色四同顺不计一色三同顺、一般高、四归一（严格98规则不计缺一门）
-    if (fan_table[QUADRUPLE_CHOW]) {
-        fan_table[PURE_SHIFTED_PUNGS] = 0;
-        fan_table[TILE_HOG] = 0;
-        fan_table[PURE_DOUBLE_CHOW] = 0;
-#ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
-#endif
-    }
+    { QUADRUPLE_CHOW, make_fan_set(PURE_SHIFTED_PUNGS, TILE_HOG, PURE_DOUBLE_CHOW, STRICT_98_ONE_VOIDED_SUIT) },
     // 一色四节高不计一色三节高、碰碰和（严格98规则不计缺一门）
-    if (fan_table[FOUR_PURE_SHIFTED_PUNGS]) {
-        fan_table[PURE_TRIPLE_CHOW] = 0;
-        fan_table[ALL_PUNGS] = 0;
-#ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
-#endif
-    }
+    { FOUR_PURE_SHIFTED_PUNGS, make_fan_set(PURE_TRIPLE_CHOW, ALL_PUNGS, STRICT_98_ONE_VOIDED_SUIT) },
 
     // 一色四步高不计一色三步高、老少副、连六（严格98规则不计缺一门）
-    if (fan_table[FOUR_PURE_SHIFTED_CHOWS]) {
-        fan_table[PURE_SHIFTED_CHOWS] = 0;
-        fan_table[TWO_TERMINAL_CHOWS] = 0;
-        fan_table[SHORT_STRAIGHT] = 0;
-#ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
-#endif
-    }
+    { FOUR_PURE_SHIFTED_CHOWS, make_fan_set(PURE_SHIFTED_CHOWS, TWO_TERMINAL_CHOWS, SHORT_STRAIGHT, STRICT_98_ONE_VOIDED_SUIT) },
 
     // 混幺九不计碰碰和、全带幺、幺九刻
-    if (fan_table[ALL_TERMINALS_AND_HONORS]) {
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[OUTSIDE_HAND] = 0;
-        fan_table[PUNG_OF_TERMINALS_OR_HONORS] = 0;
-    }
+    { ALL_TERMINALS_AND_HONORS, make_fan_set(ALL_PUNGS, OUTSIDE_HAND, PUNG_OF_TERMINALS_OR_HONORS) },
 
     // 七对不计门前清、单钓将
-    if (fan_table[SEVEN_PAIRS]) {
-        fan_table[CONCEALED_HAND] = 0;
-        fan_table[SINGLE_WAIT] = 0;
-    }
+    { SEVEN_PAIRS, make_fan_set(CONCEALED_HAND, SINGLE_WAIT) },
     // 七星不靠不计五门齐、门前清
-    if (fan_table[GREATER_HONORS_AND_KNITTED_TILES]) {
-        fan_table[ALL_TYPES] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-    }
+    { GREATER_HONORS_AND_KNITTED_TILES, make_fan_set(ALL_TYPES, CONCEALED_HAND) },
     // 全双刻不计碰碰胡、断幺、无字
-    if (fan_table[ALL_EVEN_PUNGS]) {
-        fan_table[ALL_PUNGS] = 0;
-        fan_table[ALL_SIMPLES] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { ALL_EVEN_PUNGS, make_fan_set(ALL_PUNGS, ALL_SIMPLES, NO_HONORS) },
     // 清一色不计缺一门、无字
-    if (fan_table[FULL_FLUSH]) {
-        fan_table[ONE_VOIDED_SUIT] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { FULL_FLUSH, make_fan_set(ONE_VOIDED_SUIT, NO_HONORS) },
     // 一色三同顺不计一色三节高、一般高
-    if (fan_table[PURE_TRIPLE_CHOW]) {
-        fan_table[PURE_SHIFTED_PUNGS] = 0;
-        fan_table[PURE_DOUBLE_CHOW] = 0;
-    }
+    { PURE_TRIPLE_CHOW, make_fan_set(PURE_SHIFTED_PUNGS, PURE_DOUBLE_CHOW) },
     // 一色三节高不计一色三同顺
-    if (fan_table[PURE_SHIFTED_PUNGS]) {
-        fan_table[PURE_TRIPLE_CHOW] = 0;
-    }
+    { PURE_SHIFTED_PUNGS, make_fan_set(PURE_TRIPLE_CHOW) },
     // 全大不计大于五、无字
-    if (fan_table[UPPER_TILES]) {
-        fan_table[UPPER_FOUR] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { UPPER_TILES, make_fan_set(UPPER_FOUR, NO_HONORS) },
     // 全中不计断幺
-    if (fan_table[MIDDLE_TILES]) {
-        fan_table[ALL_SIMPLES] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { MIDDLE_TILES, make_fan_set(ALL_SIMPLES, NO_HONORS) },
     // 全小不计小于五、无字
-    if (fan_table[LOWER_TILES]) {
-        fan_table[LOWER_FOUR] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { LOWER_TILES, make_fan_set(LOWER_FOUR, NO_HONORS) },
 
     // 三色双龙会不计平和、无字、喜相逢、老少副
-    if (fan_table[THREE_SUITED_TERMINAL_CHOWS]) {
-        fan_table[ALL_CHOWS] = 0;
-        fan_table[NO_HONORS] = 0;
-        fan_table[MIXED_DOUBLE_CHOW] = 0;
-        fan_table[TWO_TERMINAL_CHOWS] = 0;
-    }
+    { THREE_SUITED_TERMINAL_CHOWS, make_fan_set(ALL_CHOWS, NO_HONORS, MIXED_DOUBLE_CHOW, TWO_TERMINAL_CHOWS) },
     // 全带五不计断幺、无字
-    if (fan_table[ALL_FIVE]) {
-        fan_table[ALL_SIMPLES] = 0;
-        fan_table[NO_HONORS] = 0;
-    }
+    { ALL_FIVE, make_fan_set(ALL_SIMPLES, NO_HONORS) },
 
-    // 七星不靠不计五门齐、门前清
-    if (fan_table[LESSER_HONORS_AND_KNITTED_TILES]) {
-        fan_table[ALL_TYPES] = 0;
-        fan_table[CONCEALED_HAND] = 0;
-    }
+    // 全不靠不计五门齐、门前清
+    { LESSER_HONORS_AND_KNITTED_TILES, make_fan_set(ALL_TYPES, CONCEALED_HAND) },
     // 大于五不计无字
-    if (fan_table[UPPER_FOUR]) {
-        fan_table[NO_HONORS] = 0;
-    }
+    { UPPER_FOUR, make_fan_set(NO_HONORS) },
     // 小于五不计无字
-    if (fan_table[LOWER_FOUR]) {
-        fan_table[NO_HONORS] = 0;
-    }
-    // 三风刻内部不再计幺九刻（严格98规则不计缺一门）
-    if (fan_table[BIG_THREE_WINDS]) {
-        // 如果不是字一色或混幺九，则要减去3个幺九刻
-        if (!fan_table[ALL_HONORS] && !fan_table[ALL_TERMINALS_AND_HONORS]) {
-            assert(fan_table[PUNG_OF_TERMINALS_OR_HONORS] >= 3);
-            fan_table[PUNG_OF_TERMINALS_OR_HONORS] -= 3;
-        }
-#ifdef STRICT_98_RULE
-        fan_table[ONE_VOIDED_SUIT] = 0;
-#endif
-    }
+    { LOWER_FOUR, make_fan_set(NO_HONORS) },
+    // 三风刻（严格98规则不计缺一门）
+    { BIG_THREE_WINDS, make_fan_set(STRICT_98_ONE_VOIDED_SUIT) },
 
     // 推不倒不计缺一门
-    if (fan_table[REVERSIBLE_TILES]) {
-        fan_table[ONE_VOIDED_SUIT] = 0;
-    }
+    { REVERSIBLE_TILES, make_fan_set(ONE_VOIDED_SUIT) },
     // 妙手回春不计自摸
-    if (fan_table[LAST_TILE_DRAW]) {
-        fan_table[SELF_DRAWN] = 0;
-    }
+    { LAST_TILE_DRAW, make_fan_set(SELF_DRAWN) },
     // 杠上开花不计自摸
-    if (fan_table[OUT_WITH_REPLACEMENT_TILE]) {
-        fan_table[SELF_DRAWN] = 0;
-    }
+    { OUT_WITH_REPLACEMENT_TILE, make_fan_set(SELF_DRAWN) },
     // 抢杠和不计和绝张
-    if (fan_table[ROBBING_THE_KONG]) {
-        fan_table[LAST_TILE] = 0;
-    }
+    { ROBBING_THE_KONG, make_fan_set(LAST_TILE) },
     // 双暗杠不计暗杠
-    if (fan_table[TWO_CONCEALED_KONGS]) {
-        fan_table[CONCEALED_KONG] = 0;
-    }
+    { TWO_CONCEALED_KONGS, make_fan_set(CONCEALED_KONG) },
 
     // 混一色不计缺一门
-    if (fan_table[HALF_FLUSH]) {
-        fan_table[ONE_VOIDED_SUIT] = 0;
-    }
+    { HALF_FLUSH, make_fan_set(ONE_VOIDED_SUIT) },
     // 全求人不计单钓将
-    if (fan_table[MELDED_HAND]) {
-        fan_table[SINGLE_WAIT] = 0;
-    }
+    { MELDED_HAND, make_fan_set(SINGLE_WAIT) },
     // 双箭刻不计箭刻
-    if (fan_table[TWO_DRAGONS_PUNGS]) {
-        fan_table[DRAGON_PUNG] = 0;
-    }
+    { TWO_DRAGONS_PUNGS, make_fan_set(DRAGON_PUNG) },
 
     // 不求人不计自摸
-    if (fan_table[FULLY_CONCEALED_HAND]) {
-        fan_table[SELF_DRAWN] = 0;
-    }
+    { FULLY_CONCEALED_HAND, make_fan_set(SELF_DRAWN) },
     // 双明杠不计明杠
-    if (fan_table[TWO_MELDED_KONGS]) {
-        fan_table[MELDED_KONG] = 0;
-    }
+    { TWO_MELDED_KONGS, make_fan_set(MELDED_KONG) },
 
     // 平和不计无字
-    if (fan_table[ALL_CHOWS]) {
-        fan_table[NO_HONORS] = 0;
-    }
+    { ALL_CHOWS, make_fan_set(NO_HONORS) },
     // 断幺不计无字
-    if (fan_table[ALL_SIMPLES]) {
-        fan_table[NO_HONORS] = 0;
-    }
+    { ALL_SIMPLES, make_fan_set(NO_HONORS) }
+};
+
+#undef STRICT_98_ONE_VOIDED_SUIT
+#undef STRICT_98_TRIPLE_PUNG
+
+// 番种集合一个字中最低位的番种
+static FORCE_INLINE int fan_set_word_first(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    return tile_set_count((word & (~word + 1)) - 1);
+#endif
 }
 
+// 统一调整一些不计的
+static void adjust_fan_table(fan_table_t &fan_table) {
+    // 九莲宝灯、四暗刻把不求人修正为自摸
+    if (fan_table[FULLY_CONCEALED_HAND] && (fan_table[NINE_GATES] || fan_table[FOUR_CONCEALED_PUNGS])) {
+        fan_table[SELF_DRAWN] = 1;
+    }
+    // 九莲宝灯减计1个幺九刻
+    if (fan_table[NINE_GATES]) {
+        --fan_table[PUNG_OF_TERMINALS_OR_HONORS];
+    }
+
+    // 按表依次不计
+    for (const exclusion_rule_t &rule : exclusion_rules) {
+        if (fan_table[rule.fan] == 0) {
+            continue;
+        }
+        for (int i = 0; i < 2; ++i) {
+            uint64_t excluded = rule.excluded.bits[i];
+            while (excluded != 0) {
+                fan_table[i * 64 + fan_set_word_first(excluded)] = 0;
+                excluded &= excluded - 1;
+            }
+        }
+    }
+
+    // 三风刻内部不再计幺九刻，如果不是字一色或混幺九，则要减去3个幺九刻
+    if (fan_table[BIG_THREE_WINDS] && !fan_table[ALL_HONORS] && !fan_table[ALL_TERMINALS_AND_HONORS]) {
+        assert(fan_table[PUNG_OF_TERMINALS_OR_HONORS] >= 3);
+        fan_table[PUNG_OF_TERMINALS_OR_HONORS] -= 3;
+    }
+}
 
 // 调整圈风刻、门风刻
 static void adjust_by_winds(tile_t tile, wind_t prevalent_wind, wind_t seat_wind, fan_table_t &fan_table) {
@@ -1574,31 +1612,106 @@ static void adjust_by_win_flag(win_flag_t win_flag, fan_table_t &fan_table) {
     }
 }
 
-// 基本和型算番
-static void calculate_basic_form_fan(const pack_t (&packs)[5], const calculate_param_t *calculate_param, win_flag_t win_flag, fan_table_t &fan_table) {
-    pack_t pair_pack = 0;
-    pack_t chow_packs[4];
-    pack_t pung_packs[4];
-    intptr_t chow_cnt = 0;
-    intptr_t pung_cnt = 0;
-    for (int i = 0; i < 5; ++i) {
-        switch (pack_get_type(packs[i])) {
-        case PACK_TYPE_CHOW: chow_packs[chow_cnt++] = packs[i]; break;
-        case PACK_TYPE_PUNG:
-        case PACK_TYPE_KONG: pung_packs[pung_cnt++] = packs[i]; break;
-        case PACK_TYPE_PAIR: pair_pack = packs[i]; break;
-        default: UNREACHABLE(); return;
+// 从番表计算番数
+static int get_fan_by_table(const fan_table_t &fan_table) {
+    int fan = 0;
+    for (int i = 1; i < FAN_TABLE_SIZE; ++i) {
+        if (fan_table[i] == 0) {
+            continue;
+        }
+        fan += fan_value_table[i] * fan_table[i];
+#if 0  // Debug
+        if (fan_table[i] == 1) {
+            LOG("%s %hu\n", fan_name[i], fan_value_table[i]);
+        }
+        else {
+            LOG("%s %hu*%hu\n", fan_name[i], fan_value_table[i], fan_table[i]);
+        }
+#endif
+    }
+    return fan;
+}
+
+namespace {
+
+    // 基本和型中与划分无关的番，同一手牌的各种划分只需要计算一次
+    struct hand_fan_info_t {
+        fan_table_t fan_table;  ///< 和牌标记、九莲宝灯、花色、牌特性、数牌范围、四归一
+        bool single_wait;       ///< 是否只听1张
+    };
+
+}
+
+// 计算基本和型中与划分无关的番
+static void calculate_hand_fan_info(const calculate_param_t *calculate_param, win_flag_t win_flag, hand_fan_info_t *info) {
+    const hand_tiles_t *hand_tiles = &calculate_param->hand_tiles;
+    intptr_t fixed_cnt = hand_tiles->pack_count;
+    const tile_t *standing_tiles = hand_tiles->standing_tiles;
+    intptr_t standing_cnt = hand_tiles->tile_count;
+
+    fan_table_t &fan_table = info->fan_table;
+    memset(fan_table, 0, sizeof(fan_table));
+
+    // 根据和牌标记调整——涉及番种：和绝张、妙手回春、海底捞月、自摸
+    adjust_by_win_flag(win_flag, fan_table);
+
+    bool heaven_win = (win_flag & (WIN_FLAG_INIT | WIN_FLAG_SELF_DRAWN)) == (WIN_FLAG_INIT | WIN_FLAG_SELF_DRAWN);
+
+    // 九莲宝灯
+    if (!heaven_win && standing_cnt == 13) {
+        if (is_nine_gates(standing_tiles)) {
+            fan_table[NINE_GATES] = 1;
+        }
+    }
+
+    tile_t tiles[18];
+    memcpy(tiles, standing_tiles, standing_cnt * sizeof(tile_t));
+    intptr_t tile_cnt = packs_to_tiles(hand_tiles->fixed_packs, fixed_cnt, &tiles[standing_cnt], 18 - standing_cnt);
+    tile_cnt += standing_cnt;
+    tiles[tile_cnt++] = calculate_param->win_tile;
+
+    // 根据花色调整——涉及番种：无字、缺一门、混一色、清一色、五门齐
+    adjust_by_suits(tiles, tile_cnt, fan_table);
+    // 根据牌特性调整——涉及番种：断幺、推不倒、绿一色、字一色、清幺九、混幺九
+    adjust_by_tiles_traits(tiles, tile_cnt, fan_table);
+    // 根据数牌的范围调整——涉及番种：大于五、小于五、全大、全中、全小
+    adjust_by_rank_range(tiles, tile_cnt, fan_table);
+    // 四归一调整
+    adjust_by_tiles_hog(tiles, tile_cnt, fan_table);
+
+    // 听牌方式只与立牌有关，天和不计边张、嵌张、单钓将
+    info->single_wait = !heaven_win && is_single_wait(standing_tiles, standing_cnt, 5 - fixed_cnt);
+}
+
+// 基本和型算番
+// 与划分无关的番从info中取。先算与划分有关的番，如果番数的上界都达不到min_fan，则提前返回false，此时番表不完整
+// 副露组数FixedCnt为模板参数，按0~4分别生成，packs的前FixedCnt组为副露
+template <intptr_t FixedCnt>
+static bool calculate_basic_form_fan(const pack_t (&packs)[5], const calculate_param_t *calculate_param, win_flag_t win_flag,
+    const hand_fan_info_t &info, int min_fan, fan_table_t &fan_table) {
+    pack_t pair_pack = 0;
+    pack_t chow_packs[4];
+    pack_t pung_packs[4];
+    intptr_t chow_cnt = 0;
+    intptr_t pung_cnt = 0;
+    for (int i = 0; i < 5; ++i) {
+        switch (pack_get_type(packs[i])) {
+        case PACK_TYPE_CHOW: chow_packs[chow_cnt++] = packs[i]; break;
+        case PACK_TYPE_PUNG:
+        case PACK_TYPE_KONG: pung_packs[pung_cnt++] = packs[i]; break;
+        case PACK_TYPE_PAIR: pair_pack = packs[i]; break;
+        default: UNREACHABLE(); return false;
         }
     }
 
     if (pair_pack == 0 || chow_cnt + pung_cnt != 4) {
-        return;
+        return false;
     }
 
     tile_t win_tile = calculate_param->win_tile;
 
-    // 根据和牌标记调整——涉及番种：和绝张、妙手回春、海底捞月、自摸
-    adjust_by_win_flag(win_flag, fan_table);
+    // 与划分无关的番，这些番种与下面计算的番种不重复，只有自摸可能再次被标记
+    memcpy(fan_table, info.fan_table, sizeof(fan_table));
 
     // 点和的牌张，如果不能解释为顺子中的一张，那么将其解释为刻子，并标记这个刻子为明刻
     if ((win_flag & WIN_FLAG_SELF_DRAWN) == 0) {
@@ -1691,46 +1804,37 @@ static void calculate_basic_form_fan(const pack_t (&packs)[5], const calculate_p
         break;
     }
 
-    intptr_t fixed_cnt = calculate_param->hand_tiles.pack_count;
-    const tile_t *standing_tiles = calculate_param->hand_tiles.standing_tiles;
-    intptr_t standing_cnt = calculate_param->hand_tiles.tile_count;
     wind_t prevalent_wind = calculate_param->prevalent_wind;
     wind_t seat_wind = calculate_param->seat_wind;
 
-    bool heaven_win = (win_flag & (WIN_FLAG_INIT | WIN_FLAG_SELF_DRAWN)) == (WIN_FLAG_INIT | WIN_FLAG_SELF_DRAWN);
-
-    // 九莲宝灯
-    if (!heaven_win && standing_cnt == 13) {
-        if (is_nine_gates(standing_tiles)) {
-            fan_table[NINE_GATES] = 1;
-        }
-    }
-
     // 根据和牌方式调整——涉及番种：不求人、全求人
-    adjust_by_self_drawn(packs, fixed_cnt, (win_flag & WIN_FLAG_SELF_DRAWN) != 0, fan_table);
+    adjust_by_self_drawn<FixedCnt>(packs, (win_flag & WIN_FLAG_SELF_DRAWN) != 0, fan_table);
     // 根据雀头调整——涉及番种：平和、小三元、小四喜
     adjust_by_pair_tile(pack_get_tile(pair_pack), chow_cnt, fan_table);
     // 根据牌组特征调整——涉及番种：全带幺、全带五、全双刻
     adjust_by_packs_traits(packs, fan_table);
 
-    tile_t tiles[18];
-    memcpy(tiles, standing_tiles, standing_cnt * sizeof(tile_t));
-    intptr_t tile_cnt = packs_to_tiles(packs, fixed_cnt, &tiles[standing_cnt], 18 - standing_cnt);
-    tile_cnt += standing_cnt;
-    tiles[tile_cnt++] = win_tile;
-
-    // 根据花色调整——涉及番种：无字、缺一门、混一色、清一色、五门齐
-    adjust_by_suits(tiles, tile_cnt, fan_table);
-    // 根据牌特性调整——涉及番种：断幺、推不倒、绿一色、字一色、清幺九、混幺九
-    adjust_by_tiles_traits(tiles, tile_cnt, fan_table);
-    // 根据数牌的范围调整——涉及番种：大于五、小于五、全大、全中、全小
-    adjust_by_rank_range(tiles, tile_cnt, fan_table);
-    // 四归一调整
-    adjust_by_tiles_hog(tiles, tile_cnt, fan_table);
+    // 估算番数的上界：剩下的调整中，不计的只会减少番数，增加的只有边张嵌张单钓将、圈风刻、门风刻，或者什么番都没有时的无番和
+    if (min_fan > fan_value_table[CHICKEN_HAND]) {
+        int max_fan = get_fan_by_table(fan_table);
+        if (info.single_wait) {
+            max_fan += fan_value_table[SINGLE_WAIT];
+        }
+        for (intptr_t i = 0; i < pung_cnt; ++i) {
+            tile_t tile = pack_get_tile(pung_packs[i]);
+            if (is_winds(tile)) {
+                max_fan += fan_value_table[PREVALENT_WIND] + fan_value_table[SEAT_WIND];
+            }
+        }
+        if (max_fan < min_fan) {
+            return false;
+        }
+    }
 
-    if (!heaven_win) {
-        // 根据听牌方式调整——涉及番种：边张、嵌张、单钓将
-        adjust_by_waiting_form(packs + fixed_cnt, 5 - fixed_cnt, standing_tiles, standing_cnt, win_tile, fan_table);
+    // 全求人和四杠不计单钓将，也不可能有边张、嵌张
+    if (info.single_wait && !fan_table[MELDED_HAND] && !fan_table[FOUR_KONGS]) {
+        // 根据和牌张的位置调整——涉及番种：边张、嵌张、单钓将
+        adjust_by_win_tile_position(packs + FixedCnt, 5 - FixedCnt, win_tile, fan_table);
     }
 
     // 统一调整一些不计的
@@ -1750,6 +1854,7 @@ static void calculate_basic_form_fan(const pack_t (&packs)[5], const calculate_p
     if (std::all_of(std::begin(fan_table), std::end(fan_table), [](uint16_t p) { return p == 0; })) {
         fan_table[CHICKEN_HAND] = 1;
     }
+    return true;
 }
 
 // “组合龙+面子+雀头”和型算番
@@ -1787,7 +1892,6 @@ static bool calculate_knitted_straight_fan(const calculate_param_t *calculate_pa
 
     // 按基本和型划分
     division_result_t result;
-    result.count = 0;
     division_t work_division;
     memset(&work_division, 0, sizeof(work_division));
 
@@ -1798,8 +1902,7 @@ static bool calculate_knitted_straight_fan(const calculate_param_t *calculate_pa
     if (fixed_cnt == 1) {
         work_division.packs[3] = fixed_packs[0];
     }
-    divide_recursively(cnt_table, fixed_cnt + 3, 0, &work_division, &result);
-    if (result.count != 1) {
+    if (!divide_tiles(cnt_table, fixed_cnt + 3, &work_division, &result) || result.count != 1) {
         return false;
     }
 
@@ -1963,26 +2066,6 @@ static bool calculate_special_form_fan(const tile_t (&standing_tiles)[14], win_f
     return true;
 }
 
-// 从番表计算番数
-static int get_fan_by_table(const fan_table_t &fan_table) {
-    int fan = 0;
-    for (int i = 1; i < FAN_TABLE_SIZE; ++i) {
-        if (fan_table[i] == 0) {
-            continue;
-        }
-        fan += fan_value_table[i] * fan_table[i];
-#if 0  // Debug
-        if (fan_table[i] == 1) {
-            LOG("%s %hu\n", fan_name[i], fan_value_table[i]);
-        }
-        else {
-            LOG("%s %hu*%hu\n", fan_name[i], fan_value_table[i], fan_table[i]);
-        }
-#endif
-    }
-    return fan;
-}
-
 // 判断立牌是否包含和牌
 bool is_standing_tiles_contains_win_tile(const tile_t *standing_tiles, intptr_t standing_cnt, tile_t win_tile) {
     return std::any_of(standing_tiles, standing_tiles + standing_cnt,
@@ -2030,22 +2113,11 @@ int check_calculator_input(const hand_tiles_t *hand_tiles, tile_t win_tile) {
     return 0;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////
-// 算番
-//
-int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_table) {
-    const hand_tiles_t *hand_tiles = &calculate_param->hand_tiles;
-    tile_t win_tile = calculate_param->win_tile;
-    win_flag_t win_flag = calculate_param->win_flag;
-
-    if (int ret = check_calculator_input(hand_tiles, win_tile)) {
-        return ret;
-    }
+// 校正和牌标记
+static win_flag_t adjust_win_flag(const hand_tiles_t *hand_tiles, tile_t win_tile, win_flag_t win_flag) {
+    const intptr_t fixed_cnt = hand_tiles->pack_count;
+    const intptr_t standing_cnt = hand_tiles->tile_count;
 
-    intptr_t fixed_cnt = hand_tiles->pack_count;
-    intptr_t standing_cnt = hand_tiles->tile_count;
-
-    // 校正和牌标记
     // 如果立牌包含和牌，则必然不是和绝张
     const bool standing_tiles_contains_win_tile = is_standing_tiles_contains_win_tile(hand_tiles->standing_tiles, standing_cnt, win_tile);
     if (standing_tiles_contains_win_tile) {
@@ -2074,11 +2146,131 @@ int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_tab
         }
     }
 
+    return win_flag;
+}
+
+// 合并立牌与和牌，并排序，最多为14张
+// 立牌未必有序，逐张插入到已排好的部分中，和牌最后插入
+static void merge_win_tile(const hand_tiles_t *hand_tiles, tile_t win_tile, tile_t (&standing_tiles)[14]) {
+    const intptr_t standing_cnt = hand_tiles->tile_count;
+    for (intptr_t i = 0; i <= standing_cnt; ++i) {
+        const tile_t tile = i < standing_cnt ? hand_tiles->standing_tiles[i] : win_tile;
+        intptr_t j = i;
+        for (; j > 0 && standing_tiles[j - 1] > tile; --j) {
+            standing_tiles[j] = standing_tiles[j - 1];
+        }
+        standing_tiles[j] = tile;
+    }
+}
+
+// 特殊和型的番，返回是否构成特殊和型
+static bool calculate_special_forms_fan(const calculate_param_t *calculate_param, win_flag_t win_flag,
+    const tile_t (&standing_tiles)[14], fan_table_t &fan_table) {
+    const intptr_t fixed_cnt = calculate_param->hand_tiles.pack_count;
+    if (fixed_cnt == 0) {  // 门清状态，有可能是基本和型组合龙
+        if (calculate_knitted_straight_fan(calculate_param, win_flag, fan_table)) {
+            return true;
+        }
+        if (calculate_special_form_fan(standing_tiles, win_flag, fan_table)) {
+            return true;
+        }
+    }
+    else if (fixed_cnt == 1) {  // 1副露状态，有可能是基本和型组合龙
+        if (calculate_knitted_straight_fan(calculate_param, win_flag, fan_table)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 遍历各种划分方式，分别算番，找出最大的番的划分方式
+// max_fan与selected_fan_table传入时为目前的最大番，有更大的则更新之
+// 番数上界不超过目前最大番的划分不可能被选中，不用完整算番。fan_tables轮流用作当前划分与最大番划分的番表
+template <intptr_t FixedCnt>
+static void calculate_divisions_fan(const division_result_t &result, const calculate_param_t *calculate_param, win_flag_t win_flag,
+    fan_table_t (&fan_tables)[2], int *max_fan, const fan_table_t **selected_fan_table) {
+    hand_fan_info_t info;
+    calculate_hand_fan_info(calculate_param, win_flag, &info);
+
+    for (intptr_t i = 0; i < result.count; ++i) {
+#if 0  // Debug
+        char str[64];
+        packs_to_string(result.divisions[i].packs, 5, str, sizeof(str));
+        puts(str);
+#endif
+        fan_table_t &fan_table = (*selected_fan_table == &fan_tables[0]) ? fan_tables[1] : fan_tables[0];
+        if (!calculate_basic_form_fan<FixedCnt>(result.divisions[i].packs, calculate_param, win_flag, info, *max_fan + 1, fan_table)) {
+            continue;
+        }
+        int current_fan = get_fan_by_table(fan_table);
+        if (current_fan > *max_fan) {
+            *max_fan = current_fan;
+            *selected_fan_table = &fan_table;
+        }
+        LOG("fan = %d\n\n", current_fan);
+    }
+}
+
+// 按副露组数分派到各个特化的版本，之后的循环中不再判断副露组数
+static void calculate_divisions_fan(const division_result_t &result, const calculate_param_t *calculate_param, win_flag_t win_flag,
+    fan_table_t (&fan_tables)[2], int *max_fan, const fan_table_t **selected_fan_table) {
+    switch (calculate_param->hand_tiles.pack_count) {
+    case 0: calculate_divisions_fan<0>(result, calculate_param, win_flag, fan_tables, max_fan, selected_fan_table); break;
+    case 1: calculate_divisions_fan<1>(result, calculate_param, win_flag, fan_tables, max_fan, selected_fan_table); break;
+    case 2: calculate_divisions_fan<2>(result, calculate_param, win_flag, fan_tables, max_fan, selected_fan_table); break;
+    case 3: calculate_divisions_fan<3>(result, calculate_param, win_flag, fan_tables, max_fan, selected_fan_table); break;
+    case 4: calculate_divisions_fan<4>(result, calculate_param, win_flag, fan_tables, max_fan, selected_fan_table); break;
+    default: UNREACHABLE(); break;
+    }
+}
+
+// 是否有一种划分达到min_fan
+template <intptr_t FixedCnt>
+static bool is_any_division_reach_fan(const division_result_t &result, const calculate_param_t *calculate_param, win_flag_t win_flag,
+    int min_fan, fan_table_t &fan_table) {
+    hand_fan_info_t info;
+    calculate_hand_fan_info(calculate_param, win_flag, &info);
+    for (intptr_t i = 0; i < result.count; ++i) {
+        if (calculate_basic_form_fan<FixedCnt>(result.divisions[i].packs, calculate_param, win_flag, info, min_fan, fan_table)
+            && get_fan_by_table(fan_table) >= min_fan) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 按副露组数分派到各个特化的版本
+static bool is_any_division_reach_fan(const division_result_t &result, const calculate_param_t *calculate_param, win_flag_t win_flag,
+    int min_fan, fan_table_t &fan_table) {
+    switch (calculate_param->hand_tiles.pack_count) {
+    case 0: return is_any_division_reach_fan<0>(result, calculate_param, win_flag, min_fan, fan_table);
+    case 1: return is_any_division_reach_fan<1>(result, calculate_param, win_flag, min_fan, fan_table);
+    case 2: return is_any_division_reach_fan<2>(result, calculate_param, win_flag, min_fan, fan_table);
+    case 3: return is_any_division_reach_fan<3>(result, calculate_param, win_flag, min_fan, fan_table);
+    case 4: return is_any_division_reach_fan<4>(result, calculate_param, win_flag, min_fan, fan_table);
+    default: UNREACHABLE(); return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 算番
+//
+int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_table) {
+    const hand_tiles_t *hand_tiles = &calculate_param->hand_tiles;
+    tile_t win_tile = calculate_param->win_tile;
+
+    if (int ret = check_calculator_input(hand_tiles, win_tile)) {
+        return ret;
+    }
+
+    intptr_t fixed_cnt = hand_tiles->pack_count;
+
+    // 校正和牌标记
+    win_flag_t win_flag = adjust_win_flag(hand_tiles, win_tile, calculate_param->win_flag);
+
     // 合并立牌与和牌，并排序，最多为14张
     tile_t standing_tiles[14];
-    memcpy(standing_tiles, hand_tiles->standing_tiles, standing_cnt * sizeof(tile_t));
-    standing_tiles[standing_cnt] = win_tile;
-    std::sort(standing_tiles, standing_tiles + standing_cnt + 1);
+    merge_win_tile(hand_tiles, win_tile, standing_tiles);
 
     // 最大番标记
     int max_fan = 0;
@@ -2088,49 +2280,20 @@ int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_tab
     fan_table_t special_fan_table = { 0 };
 
     // 先判断各种特殊和型
-    if (fixed_cnt == 0) {  // 门清状态，有可能是基本和型组合龙
-        if (calculate_knitted_straight_fan(calculate_param, win_flag, special_fan_table)) {
-            max_fan = get_fan_by_table(special_fan_table);
-            selected_fan_table = &special_fan_table;
-            LOG("fan = %d\n\n", max_fan);
-        }
-        else if (calculate_special_form_fan(standing_tiles, win_flag, special_fan_table)) {
-            max_fan = get_fan_by_table(special_fan_table);
-            selected_fan_table = &special_fan_table;
-            LOG("fan = %d\n\n", max_fan);
-        }
-    }
-    else if (fixed_cnt == 1) {  // 1副露状态，有可能是基本和型组合龙
-        if (calculate_knitted_straight_fan(calculate_param, win_flag, special_fan_table)) {
-            max_fan = get_fan_by_table(special_fan_table);
-            selected_fan_table = &special_fan_table;
-            LOG("fan = %d\n\n", max_fan);
-        }
+    if (calculate_special_forms_fan(calculate_param, win_flag, standing_tiles, special_fan_table)) {
+        max_fan = get_fan_by_table(special_fan_table);
+        selected_fan_table = &special_fan_table;
+        LOG("fan = %d\n\n", max_fan);
     }
 
     // 无法构成特殊和型或者为七对
     // 七对也要按基本和型划分，因为极端情况下，基本和型的番会超过七对的番
+    fan_table_t fan_tables[2];
     if (selected_fan_table == nullptr || special_fan_table[SEVEN_PAIRS] == 1) {
         // 划分
         division_result_t result;
         if (divide_win_hand(standing_tiles, hand_tiles->fixed_packs, fixed_cnt, &result)) {
-            fan_table_t fan_tables[MAX_DIVISION_CNT] = { { 0 } };
-
-            // 遍历各种划分方式，分别算番，找出最大的番的划分方式
-            for (intptr_t i = 0; i < result.count; ++i) {
-#if 0  // Debug
-                char str[64];
-                packs_to_string(result.divisions[i].packs, 5, str, sizeof(str));
-                puts(str);
-#endif
-                calculate_basic_form_fan(result.divisions[i].packs, calculate_param, win_flag, fan_tables[i]);
-                int current_fan = get_fan_by_table(fan_tables[i]);
-                if (current_fan > max_fan) {
-                    max_fan = current_fan;
-                    selected_fan_table = &fan_tables[i];
-                }
-                LOG("fan = %d\n\n", current_fan);
-            }
+            calculate_divisions_fan(result, calculate_param, win_flag, fan_tables, &max_fan, &selected_fan_table);
         }
     }
 
@@ -2149,4 +2312,211 @@ int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_tab
     return max_fan;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 紧凑的算番结果
+//
+bool fan_table_to_result(const fan_table_t &fan_table, fan_result_t *fan_result) {
+    fan_result->fan_mask[0] = 0;
+    fan_result->fan_mask[1] = 0;
+    fan_result->fan_counts = 0;
+
+    int kinds = 0;
+    for (int i = 1; i < FAN_TABLE_SIZE; ++i) {
+        if (fan_table[i] == 0) {
+            continue;
+        }
+        if (kinds == FAN_RESULT_MAX_KINDS || fan_table[i] > FAN_RESULT_MAX_COUNT) {
+            return false;
+        }
+        fan_result->fan_mask[i >> 6] |= 1ULL << (i & 63);
+        fan_result->fan_counts |= static_cast<uint64_t>(fan_table[i] - 1) << (kinds * 4);
+        ++kinds;
+    }
+    return true;
+}
+
+void fan_result_to_table(const fan_result_t &fan_result, fan_table_t *fan_table) {
+    memset(*fan_table, 0, sizeof(*fan_table));
+
+    fan_result_t temp = fan_result;
+    fan_t fan;
+    uint16_t count;
+    while (fan_result_pop(&temp, &fan, &count)) {
+        (*fan_table)[fan] = count;
+    }
+}
+
+int get_fan_by_result(const fan_result_t &fan_result) {
+    int fan_value = 0;
+
+    fan_result_t temp = fan_result;
+    fan_t fan;
+    uint16_t count;
+    while (fan_result_pop(&temp, &fan, &count)) {
+        fan_value += fan_value_table[fan] * count;
+    }
+    return fan_value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 判断是否达到起和番
+//
+bool meets_fan_threshold(const calculate_param_t *calculate_param, int min_fan) {
+    const hand_tiles_t *hand_tiles = &calculate_param->hand_tiles;
+    tile_t win_tile = calculate_param->win_tile;
+
+    if (check_calculator_input(hand_tiles, win_tile) != 0) {
+        return false;
+    }
+
+    intptr_t fixed_cnt = hand_tiles->pack_count;
+    intptr_t standing_cnt = hand_tiles->tile_count;
+
+    // 校正和牌标记
+    win_flag_t win_flag = adjust_win_flag(hand_tiles, win_tile, calculate_param->win_flag);
+
+    // 合并立牌与和牌，并排序，最多为14张
+    tile_t standing_tiles[14];
+    merge_win_tile(hand_tiles, win_tile, standing_tiles);
+
+    fan_table_t fan_table = { 0 };
+
+    // 先判断各种特殊和型
+    if (calculate_special_forms_fan(calculate_param, win_flag, standing_tiles, fan_table)) {
+        if (get_fan_by_table(fan_table) >= min_fan) {
+            return true;
+        }
+        // 七对之外的特殊和型不可能再按基本和型划分
+        if (fan_table[SEVEN_PAIRS] != 1) {
+            return false;
+        }
+    }
+
+    // 查表判断基本和型是否和牌，没和的不用划分
+    if (!is_basic_form_win(hand_tiles->standing_tiles, standing_cnt, win_tile)) {
+        return false;
+    }
+
+    // 划分，逐个划分算番，只要有一种达到就可以返回了
+    division_result_t result;
+    if (!divide_win_hand(standing_tiles, hand_tiles->fixed_packs, fixed_cnt, &result)) {
+        return false;
+    }
+    return is_any_division_reach_fan(result, calculate_param, win_flag, min_fan, fan_table);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 对所有能和的牌分别算番
+//
+intptr_t calculate_fan_for_waits(const calculate_param_t *calculate_param, wait_fan_t *results) {
+    const hand_tiles_t *hand_tiles = &calculate_param->hand_tiles;
+
+    // 打表，包括副露
+    tile_table_t cnt_table;
+    if (!map_hand_tiles(hand_tiles, &cnt_table)) {
+        return ERROR_WRONG_TILES_COUNT;
+    }
+    if (std::any_of(std::begin(cnt_table), std::end(cnt_table), [](int cnt) { return cnt > 4; })) {
+        return ERROR_TILE_COUNT_GREATER_THAN_4;
+    }
+
+    // 所有和型的听牌
+    useful_table_t waiting_table;
+    if (!is_waiting(*hand_tiles, &waiting_table)) {
+        return 0;
+    }
+
+    const intptr_t fixed_cnt = hand_tiles->pack_count;
+    const intptr_t standing_cnt = hand_tiles->tile_count;
+
+    // 立牌打表，再由表还原出排好序的立牌
+    tile_table_t standing_table;
+    map_tiles(hand_tiles->standing_tiles, standing_cnt, &standing_table);
+    tile_t sorted_tiles[13];
+    table_to_tiles(standing_table, sorted_tiles, 13);
+
+    // 立牌各门花色的划分，和牌张只影响其所在的一门花色，其余花色的划分在各和牌张之间共享
+    intptr_t suit_cnt[4];
+    suit_division_result_t suit_results[4];
+    for (int i = 0; i < 4; ++i) {
+        suit_t suit = static_cast<suit_t>(TILE_SUIT_CHARACTERS + i);
+        suit_cnt[i] = count_suit_tiles(standing_table, suit);
+        divide_suit(standing_table, suit, suit_cnt[i], &suit_results[i]);
+    }
+
+    calculate_param_t param;
+    memcpy(&param, calculate_param, sizeof(param));
+
+    intptr_t cnt = 0;
+    for (int n = 0; n < 34; ++n) {
+        const tile_t win_tile = all_tiles[n];
+        if (!waiting_table[win_tile] || cnt_table[win_tile] >= 4) {  // 不听，或者已经没有这张牌了
+            continue;
+        }
+
+        param.win_tile = win_tile;
+        const win_flag_t win_flag = adjust_win_flag(hand_tiles, win_tile, calculate_param->win_flag);
+
+        // 合并立牌与和牌，已经排好序的立牌只需要插入和牌
+        tile_t standing_tiles[14];
+        tile_t *pos = std::upper_bound(sorted_tiles, sorted_tiles + standing_cnt, win_tile);
+        std::copy(sorted_tiles, pos, standing_tiles);
+        standing_tiles[pos - sorted_tiles] = win_tile;
+        std::copy(pos, sorted_tiles + standing_cnt, standing_tiles + (pos - sorted_tiles) + 1);
+
+        int max_fan = 0;
+        const fan_table_t *selected_fan_table = nullptr;
+
+        // 先判断各种特殊和型
+        fan_table_t special_fan_table = { 0 };
+        if (calculate_special_forms_fan(&param, win_flag, standing_tiles, special_fan_table)) {
+            max_fan = get_fan_by_table(special_fan_table);
+            selected_fan_table = &special_fan_table;
+        }
+
+        // 无法构成特殊和型或者为七对，按基本和型划分，只需要重新划分和牌张所在的一门花色
+        fan_table_t fan_tables[2];
+        if (selected_fan_table == nullptr || special_fan_table[SEVEN_PAIRS] == 1) {
+            const int idx = tile_get_suit(win_tile) - TILE_SUIT_CHARACTERS;
+            intptr_t temp_suit_cnt[4];
+            memcpy(temp_suit_cnt, suit_cnt, sizeof(temp_suit_cnt));
+            ++temp_suit_cnt[idx];
+
+            if (is_suit_counts_dividable(temp_suit_cnt)) {
+                suit_division_result_t temp_result;
+                ++standing_table[win_tile];
+                divide_suit(standing_table, tile_get_suit(win_tile), temp_suit_cnt[idx], &temp_result);
+                --standing_table[win_tile];
+
+                const suit_division_result_t *suit_result_ptrs[4];
+                for (int i = 0; i < 4; ++i) {
+                    suit_result_ptrs[i] = (i == idx) ? &temp_result : &suit_results[i];
+                }
+                if (std::all_of(std::begin(suit_result_ptrs), std::end(suit_result_ptrs),
+                    [](const suit_division_result_t *r) { return r->count > 0; })) {
+                    division_result_t result;
+                    result.count = 0;
+                    division_t work_division;
+                    memcpy(work_division.packs, hand_tiles->fixed_packs, fixed_cnt * sizeof(pack_t));
+                    combine_suit_divisions(suit_result_ptrs, fixed_cnt, 0, &work_division, fixed_cnt, &result);
+                    calculate_divisions_fan(result, &param, win_flag, fan_tables, &max_fan, &selected_fan_table);
+                }
+            }
+        }
+
+        if (selected_fan_table == nullptr) {
+            continue;
+        }
+
+        // 加花牌
+        wait_fan_t *wait_fan = &results[cnt++];
+        wait_fan->win_tile = win_tile;
+        wait_fan->fan = max_fan + calculate_param->flower_count;
+        memcpy(wait_fan->fan_table, *selected_fan_table, sizeof(wait_fan->fan_table));
+        wait_fan->fan_table[FLOWER_TILES] = calculate_param->flower_count;
+    }
+
+    return cnt;
+}
+
 }
@@ -218,12 +218,107 @@ typedef uint16_t fan_table_t[FAN_TABLE_SIZE];
  */
 int calculate_fan(const calculate_param_t *calculate_param, fan_table_t *fan_table);
 
+/**
+ * @brief 紧凑的算番结果
+ *  番表每种番都占2字节，而一次和牌出现的番种通常只有几种，适合大量保存的场合用这个类型
+ *  用128位掩码标记出现的番种，出现的番种按顺序每种用4位存放次数减1，共24字节
+ */
+struct fan_result_t {
+    uint64_t fan_mask[2];   ///< 出现的番种，第i位对应番种i
+    uint64_t fan_counts;    ///< 出现的番种的次数减1，按番种顺序每种占4位
+};
+
+#define FAN_RESULT_MAX_KINDS 16  ///< 紧凑的算番结果最多容纳的番种数
+#define FAN_RESULT_MAX_COUNT 16  ///< 紧凑的算番结果中每种番最多的次数
+
+/**
+ * @brief 番表转换成紧凑的算番结果
+ *
+ * @param [in] fan_table 番表
+ * @param [out] fan_result 紧凑的算番结果
+ * @return bool 番种数超过FAN_RESULT_MAX_KINDS或者某种番的次数超过FAN_RESULT_MAX_COUNT时返回false
+ */
+bool fan_table_to_result(const fan_table_t &fan_table, fan_result_t *fan_result);
+
+/**
+ * @brief 紧凑的算番结果转换成番表
+ *
+ * @param [in] fan_result 紧凑的算番结果
+ * @param [out] fan_table 番表
+ */
+void fan_result_to_table(const fan_result_t &fan_result, fan_table_t *fan_table);
+
+/**
+ * @brief 从紧凑的算番结果计算番数
+ *
+ * @param [in] fan_result 紧凑的算番结果
+ * @return int 番数
+ */
+int get_fan_by_result(const fan_result_t &fan_result);
+
+/**
+ * @brief 取出紧凑的算番结果中序号最小的番种
+ *  遍历时复制一份结果，反复取出直到返回false，各番种按番种的顺序依次取出
+ *
+ * @param [in,out] fan_result 紧凑的算番结果，取出的番种会被移除
+ * @param [out] fan 番种
+ * @param [out] count 这种番出现的次数
+ * @return bool 结果为空时返回false
+ */
+static FORCE_INLINE bool fan_result_pop(fan_result_t *fan_result, fan_t *fan, uint16_t *count) {
+    int word = fan_result->fan_mask[0] != 0 ? 0 : 1;
+    uint64_t mask = fan_result->fan_mask[word];
+    if (mask == 0) {
+        return false;
+    }
+    uint64_t lowest = mask & (~mask + 1);
+    // 最低位以下的位数即为其下标
+    *fan = static_cast<fan_t>(word * 64 + tile_set_count(lowest - 1));
+    *count = static_cast<uint16_t>((fan_result->fan_counts & 0xF) + 1);
+    fan_result->fan_mask[word] = mask ^ lowest;
+    fan_result->fan_counts >>= 4;
+    return true;
+}
+
+/**
+ * @brief 判断是否和牌并达到起和番
+ *  不生成番表，只要有一种划分达到起和番就返回，不和的牌先查表排除，适合频繁判断能否和别人打出的牌
+ *  花牌不计入起和番
+ *
+ * @param [in] calculate_param 算番参数
+ * @param [in] min_fan 起和番，国标麻将为8
+ * @return bool 输入不合法、没和牌或者番数不足时返回false
+ */
+bool meets_fan_threshold(const calculate_param_t *calculate_param, int min_fan);
+
+/**
+ * @brief 和牌张的算番结果
+ */
+struct wait_fan_t {
+    tile_t win_tile;        ///< 和牌张
+    int fan;                ///< 番数
+    fan_table_t fan_table;  ///< 番表
+};
+
+/**
+ * @brief 对所有能和的牌分别算番
+ *  结果与对每一张牌分别调用calculate_fan相同，但输入检查、立牌排序以及和牌张所在花色之外的划分只做一次
+ *  已经没有剩余的牌（手牌中已有4枚）不计入
+ *
+ * @param [in] calculate_param 算番参数，其中的和牌张不使用
+ * @param [out] results 各和牌张的算番结果，按牌的顺序依次写入，至少要有34个元素
+ * @retval >=0 能和的牌的种数
+ * @retval ERROR_WRONG_TILES_COUNT 错误的张数
+ * @retval ERROR_TILE_COUNT_GREATER_THAN_4 某张牌出现超过4枚
+ */
+intptr_t calculate_fan_for_waits(const calculate_param_t *calculate_param, wait_fan_t *results);
+
 #if 0
 
 /**
  * @brief 番名（英文）
  */
-static const char *fan_name[] = {
+static const char *const fan_name[] = {
     "None",
     "Big Four Winds", "Big Three Dragons", "All Green", "Nine Gates", "Four Kongs", "Seven Shifted Pairs", "Thirteen Orphans",
     "All Terminals", "Little Four Winds", "Little Three Dragons", "All Honors", "Four Concealed Pungs", "Pure Terminal Chows",
@@ -267,7 +362,7 @@ static const char *fan_name[] = {
 /**
  * @brief 番名（简体中文）
  */
-static const char *fan_name[] = {
+static const char *const fan_name[] = {
     __UTF8("无"),
     __UTF8("大四喜"), __UTF8("大三元"), __UTF8("绿一色"), __UTF8("九莲宝灯"), __UTF8("四杠"), __UTF8("连七对"), __UTF8("十三幺"),
     __UTF8("清幺九"), __UTF8("小四喜"), __UTF8("小三元"), __UTF8("字一色"), __UTF8("四暗刻"), __UTF8("一色双龙会"),
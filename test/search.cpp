@@ -3,6 +3,7 @@
 #include "shanten.h"
 #include "stringify.h"
 #include "fan_calculator.h"
+#define MAHJONGGB_UNITY
 #include "MahjongGB/MahjongGB.h"
 #include <stdio.h>
 #include <iostream>
@@ -16,14 +17,9 @@ using namespace mahjong;
 using namespace std;
 
 static int count_useful_tile(const tile_table_t &used_table, const useful_table_t &useful_table) {
-    int cnt = 0;
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (useful_table[t]) {
-            cnt += 4 - used_table[t];
-        }
-    }
-    return cnt;
+    // 每种有效牌4枚，减去已经用掉的
+    tile_set_t useful_set = useful_table_to_tile_set(useful_table);
+    return 4 * tile_set_count(useful_set) - tile_set_weighted_count(useful_set, used_table);
 }
 
 char chang(int x)
@@ -178,61 +174,32 @@ string toans(int i,int j)
     tt+=change(j);
     return tt;
 }
-string cover(int i,int j)
+tile_t cover(int i,int j)//牌型转化为牌
 {
-    //cout<<"zhelima "<<endl;
-    string tmp;
-    if(i<4)
-    {
-        tmp+=change(j);
-        if(i==1)tmp+='m';
-        if(i==3)tmp+='s';
-        if(i==2)tmp+='p';
+    switch(i){
+        case 1:return make_tile(TILE_SUIT_CHARACTERS,j);
+        case 2:return make_tile(TILE_SUIT_DOTS,j);
+        case 3:return make_tile(TILE_SUIT_BAMBOO,j);
+        case 4:return make_tile(TILE_SUIT_HONORS,j);
+        default:return make_tile(TILE_SUIT_HONORS,j+4);
     }
-    else
-    {
-        if(i==4)
-        tmp=chang(j);
-        else
-        {
-            tmp=chang(j+4);
-        }
-        
-    }
-    return tmp;
 }
 
-string meow(const hand_tiles_t *hand_tiles, useful_table_t &useful_table)
-{
-    string tans;
-    char buf[64];
-        for (tile_t t = TILE_1m; t < TILE_TABLE_SIZE; ++t) {
-            if (useful_table[t]) {
-                tiles_to_string(&t, 1, buf, sizeof(buf));
-                string tmp=buf;
-                tans+=tmp+' ';
-                
-            }
-        }
-    
-    return tans;       
-}
-
-pair<int,string> test_shanten(const char *str)
+pair<int,tile_set_t> test_shanten(const char *str)
 {
     hand_tiles_t hand_tiles;
     tile_t serving_tile;
     long ret = string_to_tiles(str, &hand_tiles, &serving_tile);
     if (ret != 0) {
         //printf("error at line %d error = %ld\n", __LINE__, ret);
-        return make_pair(-1,"");
+        return make_pair(-1,tile_set_t(0));
     }
 
     char buf[20];
     ret = hand_tiles_to_string(&hand_tiles, buf, sizeof(buf));
     //puts(buf);
     
-    string tans,ans;
+    tile_set_t tans=0,ans=0;//有效牌
     auto display = [](const hand_tiles_t *hand_tiles, useful_table_t &useful_table) {
         char buf[64];
         for (tile_t t = TILE_1m; t < TILE_TABLE_SIZE; ++t) {
@@ -259,7 +226,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("131=== %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -272,7 +239,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("7d=== %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -284,7 +251,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("honors and knitted tiles  %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()){
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -297,7 +264,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("knitted straight in basic form %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()){
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
     
     if(ret>ret0)
@@ -310,7 +277,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("basic form %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
         
     }
 
@@ -481,8 +448,8 @@ string Dapai( vector<string> hand,vector<pair<string, pair<string, int> > > pack
         }
         //cout<<tmp<<endl;
         double ret=10086;
-        pair<int,string> rt;
-        string anse;
+        pair<int,tile_set_t> rt;
+        tile_set_t anse;
         rt=test_shanten(sff);
         ret=rt.first;
         ret+=0.01;
@@ -497,16 +464,7 @@ string Dapai( vector<string> hand,vector<pair<string, pair<string, int> > > pack
             ttmp=lastp[i];
             
             // cout<<"???"<<endl;
-            string wt=cover(ttmp.first,ttmp.second);
-            
-            //cout<<wt<<endl;
-            //cout<<anse<<endl;
-             //cout<<"???"<<endl;
-            string::size_type position;
- 
-            //find 函数 返回jk 在s 中的下标位置 
-            position = anse.find(wt);
-            if (position != anse.npos)
+            if (tile_set_contains(anse,cover(ttmp.first,ttmp.second)))
             {
                 //cout<<"!!@!@!@#!@#"<<endl;
                 ans+=(double)((double)num[ttmp.first][ttmp.second]/(double)lastans)/(double)ret;
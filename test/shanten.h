@@ -56,6 +56,26 @@ void map_tiles(const tile_t *tiles, intptr_t cnt, tile_table_t *cnt_table);
  */
 bool map_hand_tiles(const hand_tiles_t *hand_tiles, tile_table_t *cnt_table);
 
+/**
+ * @brief 将牌记入紧凑的计数
+ *  不合法的牌不记入，与牌表一样不参与按花色的计算
+ *
+ * @param [in] tiles 牌
+ * @param [in] cnt 牌的数量
+ * @param [out] counts 计数
+ * @return bool 是否每种牌都不超过7枚，超过时无法记录
+ */
+bool map_tile_counts(const tile_t *tiles, intptr_t cnt, tile_counts_t *counts);
+
+/**
+ * @brief 将牌表转换成紧凑的计数
+ *
+ * @param [in] cnt_table 牌的数量表
+ * @param [out] counts 计数
+ * @return bool 是否每种牌都不超过7枚，超过时无法记录
+ */
+bool table_to_tile_counts(const tile_table_t &cnt_table, tile_counts_t *counts);
+
 /**
  * @brief 将表转换成牌
  *
@@ -71,6 +91,22 @@ intptr_t table_to_tiles(const tile_table_t &cnt_table, tile_t *tiles, intptr_t m
  */
 typedef bool useful_table_t[TILE_TABLE_SIZE];
 
+/**
+ * @brief 有效牌标记表转换成牌集合
+ *
+ * @param [in] useful_table 有效牌标记表
+ * @return tile_set_t 牌集合
+ */
+tile_set_t useful_table_to_tile_set(const useful_table_t &useful_table);
+
+/**
+ * @brief 牌集合转换成有效牌标记表
+ *
+ * @param [in] set 牌集合
+ * @param [out] useful_table 有效牌标记表
+ */
+void tile_set_to_useful_table(tile_set_t set, useful_table_t *useful_table);
+
 /**
  * @addtogroup shanten
  * @{
@@ -337,6 +373,79 @@ typedef bool (*enum_callback_t)(void *context, const enum_result_t *result);
 void enum_discard_tile(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag,
     void *context, enum_callback_t enum_callback);
 
+/**
+ * @brief 批量计算打每一张牌的结果数量上限。即14种打法*5种和型
+ */
+#define MAX_DISCARD_RESULT_CNT 70
+
+/**
+ * @brief 批量计算打每一张牌的结果
+ *  结果的顺序与enum_discard_tile回调的顺序相同，先是摸切，然后依次打出手中的各种立牌
+ *
+ * @param [in] hand_tiles 手牌结构
+ * @param [in] serving_tile 上牌（可为0，此时仅计算手牌的信息）
+ * @param [in] form_flag 计算哪些和型
+ * @param [out] results 计算结果，容量至少为MAX_DISCARD_RESULT_CNT
+ * @return intptr_t 计算结果的数量，立牌数不正确或者某种牌超过4张时为0
+ */
+intptr_t evaluate_all_discards(const hand_tiles_t *hand_tiles, tile_t serving_tile, uint8_t form_flag, enum_result_t *results);
+
+/**
+ * @brief 增量计算上听数的状态
+ *  增减一张牌时，只重新计算这张牌所在的一门花色
+ *  成员仅供内部使用，请通过shanten_state_系列函数访问
+ */
+struct shanten_state_t {
+    tile_table_t cnt_table;                 ///< 立牌的数量表
+    intptr_t tile_count;                    ///< 立牌数
+    uint32_t basic_shapes[4];               ///< 各门花色的拆解结果
+    uint32_t knitted_shapes[3][3];          ///< 各门数牌分别削减147/258/369之后的拆解结果
+    uint8_t knitted_kinds[3][3];            ///< 各门数牌147/258/369的种类数
+    uint8_t pair_cnt;                       ///< 对子数（七对用）
+    uint8_t orphan_kinds;                   ///< 幺九牌的种类数
+    uint8_t orphan_pairs;                   ///< 幺九牌对子的种类数
+    uint8_t honor_kinds;                    ///< 字牌的种类数
+    uint8_t dirty_flag;                     ///< 需要重新计算的花色
+};
+
+/**
+ * @brief 初始化增量计算上听数的状态
+ *
+ * @param [out] state 状态
+ * @param [in] standing_tiles 立牌
+ * @param [in] standing_cnt 立牌数
+ * @return bool 立牌是否正确。即每种牌不超过4张
+ */
+bool shanten_state_init(shanten_state_t *state, const tile_t *standing_tiles, intptr_t standing_cnt);
+
+/**
+ * @brief 增量计算上听数的状态中增加一张牌
+ *
+ * @param [in,out] state 状态
+ * @param [in] tile 增加的牌
+ * @return bool 是否成功。这张牌已经有4张时失败
+ */
+bool shanten_state_add_tile(shanten_state_t *state, tile_t tile);
+
+/**
+ * @brief 增量计算上听数的状态中减少一张牌
+ *
+ * @param [in,out] state 状态
+ * @param [in] tile 减少的牌
+ * @return bool 是否成功。没有这张牌时失败
+ */
+bool shanten_state_remove_tile(shanten_state_t *state, tile_t tile);
+
+/**
+ * @brief 由增量计算上听数的状态获取上听数
+ *  结果与对当前立牌调用各和型的上听数函数一致
+ *
+ * @param [in,out] state 状态（增减牌之后推迟的计算在这里完成）
+ * @param [in] form_flag 计算哪些和型
+ * @return int 指定和型中最小的上听数
+ */
+int shanten_state_query(shanten_state_t *state, uint8_t form_flag);
+
 }
 
 /**
@@ -2,6 +2,7 @@
 #include "shanten.h"
 #include "stringify.h"
 #include "fan_calculator.h"
+#define MAHJONGGB_UNITY
 #include "MahjongGB/MahjongGB.h"
 #include <stdio.h>
 #include <iostream>
@@ -46,16 +47,7 @@ pii f(string stmp)//牌型转化
 }
 string ff(int x,int y)//牌型转化2
 {
-   string s="";
-   switch(x){
-		case 1:s+='W';break;
-		case 2:s+='B';break;
-		case 3:s+='T';break;
-		case 4:s+='F';break;
-		case 5:s+='J';break;
-	}
-	s+=char('0'+y);
-	return  s;
+	return string{"?WBTFJ"[x],char('0'+y)};
 }
 int fff(int myID,int playID)//判断是那家供牌 
 {
@@ -63,45 +55,6 @@ int fff(int myID,int playID)//判断是那家供牌
 	if((myID+1)%4==playID)return 3;//下家供牌 
 	return 2;//对家供牌 
 }
-bool CheckHu(int num[10],int k){
-	for(int i=1;i<=k;i++)if(num[i]<0)return false;
-	if(num[0]==0)return true;
-	if(num[0]==1)return false;
-	if(num[0]==2){
-		for(int i=1;i<=k;i++)if(num[i]==2)return true;
-		return false;
-	}
-	if(k==9){
-		for(int i=1;i<=9;i++){
-			if(num[i]>0){
-				if(i<=7){
-					num[i]--,num[i+1]--,num[i+2]--;
-					num[0]=num[0]-3;
-					if(CheckHu(num,k))return true;
-					num[0]=num[0]+3;
-					num[i]++,num[i+1]++,num[i+2]++;
-				}
-				if(num[i]>=3){
-					num[i]-=3;num[0]-=3;
-					if(CheckHu(num,k))return true;
-					num[i]+=3;num[0]+=3;
-				}
-			}
-		}return false;
-	}
-    else 
-    {
-    	for(int i=1;i<=k;i++){
-    		if(num[i]>0){
-    			if(num[i]>=3){
-					num[i]-=3;num[0]-=3;
-					if(CheckHu(num,k))return true;
-					num[i]+=3;num[0]+=3;
-				}
-			}
-		}return false;
-	}
-}
 bool Hu()
 {
 	if(hand.size()<14||hand.size()>18)return false;
@@ -111,24 +64,18 @@ bool Hu()
 	} 
 	CardCount=i;//当前可操作的牌数
 	if((CardCount-2)%3!=0)return false;
-	int num[6][10]={0};//当前手牌统计
+	mahjong::tile_t tiles[18];//当前手牌
 	for(int i=0;i<CardCount;i++){
-		pii a=f(hand[i]);
-		num[a.first][a.second]++;
-		num[a.first][0]++;
+		tiles[i]=MahjongTileFromCode(hand[i]);
 	}
-	return CheckHu(num[1],9)&&CheckHu(num[2],9)&&CheckHu(num[3],9)&&CheckHu(num[4],4)&&CheckHu(num[5],3);
+	//查表判断，最后一张作为和牌张
+	return mahjong::is_basic_form_win(tiles,CardCount-1,tiles[CardCount-1]);
 }
 
 static int count_useful_tile(const tile_table_t &used_table, const useful_table_t &useful_table) {
-    int cnt = 0;
-    for (int i = 0; i < 34; ++i) {
-        tile_t t = all_tiles[i];
-        if (useful_table[t]) {
-            cnt += 4 - used_table[t];
-        }
-    }
-    return cnt;
+    // 每种有效牌4枚，减去已经用掉的
+    tile_set_t useful_set = useful_table_to_tile_set(useful_table);
+    return 4 * tile_set_count(useful_set) - tile_set_weighted_count(useful_set, used_table);
 }
 
 char chang(int x)
@@ -254,90 +201,29 @@ char change(int x)
     return tmp;
 }
 string toans(int i,int j)
-{   
-    string tt;
-    if(i==1)
-    {
-        tt+='W';
-    }
-    if(i==2)
-    {
-        tt+='T';
-    }
-    if(i==3)
-    {
-        tt+='B';
-    }
-    if(i==4)
-    {
-        if(j>=5)
-        {
-            tt+='J';
-            j-=4;
-        }
-        else
-        {
-            tt+='F';
-        }
-    }
-    tt+=change(j);
-    return tt;
-}
-string cover(int i,int j)
 {
-    //cout<<"zhelima "<<endl;
-    string tmp;
-    if(i<4)
-    {
-        tmp+=change(j);
-        if(i==1)tmp+='m';
-        if(i==3)tmp+='s';
-        if(i==2)tmp+='p';
-    }
-    else
-    {
-        if(i==4)
-        tmp=chang(j);
-        else
-        {
-            tmp=chang(j+4);
-        }
-        
-    }
-    return tmp;
+    return MahjongTileToCode(make_tile(i,j));
 }
-
-string meow(const hand_tiles_t *hand_tiles, useful_table_t &useful_table)
+tile_t cover(int i,int j)//牌型转化为牌
 {
-    string tans;
-    char buf[64];
-        for (tile_t t = TILE_1m; t < TILE_TABLE_SIZE; ++t) {
-            if (useful_table[t]) {
-                tiles_to_string(&t, 1, buf, sizeof(buf));
-                string tmp=buf;
-                tans+=tmp+' ';
-                
-            }
-        }
-    
-    return tans;       
+    return MahjongTileFromCode("?WBTFJ"[i],char('0'+j));
 }
 
-pair<int,string> test_shanten(const char *str)
+pair<int,tile_set_t> test_shanten(const char *str)
 {
     hand_tiles_t hand_tiles;
     tile_t serving_tile;
     long ret = string_to_tiles(str, &hand_tiles, &serving_tile);
     if (ret != 0) {
         //printf("error at line %d error = %ld\n", __LINE__, ret);
-        return make_pair(-1,"");
+        return make_pair(-1,tile_set_t(0));
     }
 
     char buf[20];
     ret = hand_tiles_to_string(&hand_tiles, buf, sizeof(buf));
     //puts(buf);
     
-    string tans,ans;
+    tile_set_t tans=0,ans=0;//有效牌
     auto display = [](const hand_tiles_t *hand_tiles, useful_table_t &useful_table) {
         char buf[64];
         for (tile_t t = TILE_1m; t < TILE_TABLE_SIZE; ++t) {
@@ -364,7 +250,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("131=== %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -377,7 +263,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("7d=== %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -389,7 +275,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("honors and knitted tiles  %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()){
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
 
     if(ret>ret0)
@@ -402,7 +288,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("knitted straight in basic form %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()){
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
     }
     
     if(ret>ret0)
@@ -415,7 +301,7 @@ pair<int,string> test_shanten(const char *str)
     //printf("basic form %d shanten\n", ret0);
     if (ret0 != std::numeric_limits<int>::max()) {
         display(&hand_tiles, useful_table);
-        tans=meow(&hand_tiles, useful_table);
+        tans=useful_table_to_tile_set(useful_table);
         
     }
 
@@ -569,8 +455,8 @@ double judge( vector<string> hand,vector<pair<string, pair<string, int> > > pack
         }
         
         double ret=10086;
-        pair<int,string> rt;
-        string anse;
+        pair<int,tile_set_t> rt;
+        tile_set_t anse;
         rt=test_shanten(sff);
         ret=rt.first;
         ret+=0.0001;
@@ -584,13 +470,7 @@ double judge( vector<string> hand,vector<pair<string, pair<string, int> > > pack
 
             ttmp=lastp[i];
 
-            string wt=cover(ttmp.first,ttmp.second);
-
-            string::size_type position;
- 
-            //find 函数 返回jk 在s 中的下标位置 
-            position = anse.find(wt);
-            if (position != anse.npos)
+            if (tile_set_contains(anse,cover(ttmp.first,ttmp.second)))
             {
                 //cout<<"!!@!@!@#!@#"<<endl;
                 ans+=(double)(((double)num[ttmp.first][ttmp.second]/(double)lastans))*300;
@@ -758,8 +638,8 @@ pair<double ,string> Dapai( vector<string> hand,vector<pair<string, pair<string,
         }
         //cout<<tmp<<endl;
         double ret=10086;
-        pair<int,string> rt;
-        string anse;
+        pair<int,tile_set_t> rt;
+        tile_set_t anse;
         rt=test_shanten(sff);
         ret=rt.first;
         ret+=0.0001;
@@ -775,16 +655,7 @@ pair<double ,string> Dapai( vector<string> hand,vector<pair<string, pair<string,
             ttmp=lastp[i];
             
             // cout<<"???"<<endl;
-            string wt=cover(ttmp.first,ttmp.second);
-            
-            //cout<<wt<<endl;
-            //cout<<anse<<endl;
-             //cout<<"???"<<endl;
-            string::size_type position;
- 
-            //find 函数 返回jk 在s 中的下标位置 
-            position = anse.find(wt);
-            if (position != anse.npos)
+            if (tile_set_contains(anse,cover(ttmp.first,ttmp.second)))
             {
                 //cout<<"!!@!@!@#!@#"<<endl;
                 ans+=(double)(((double)num[ttmp.first][ttmp.second]/(double)lastans))*300;
@@ -1030,14 +901,8 @@ int main()
 					sin>>stmp1>>ID>>stmp1;
 					if(ID==myPlayerID&&(stmp1=="GANG"||stmp1=="BUGANG"))isGANG=1;
 					if(paiqiang==0)isLAST=true;
-					MahjongInit();
 					try{
-					    auto re = MahjongFanCalculator(pack, myhand, stmp, 0, isZIMO, isJUEZHANG, isGANG, isLAST, myPlayerID, quan);
-					    int ans=0;
-						for(auto i : re){
-					        ans+=i.first;
-					    }
-					    if(ans>=8){sout<<"HU";ok=true;}
+					    if(MahjongFanThreshold(pack, myhand, stmp, isZIMO, isJUEZHANG, isGANG, isLAST, myPlayerID, quan, 8)){sout<<"HU";ok=true;}
 					}
 					catch(const string &error){
 					    //
@@ -1161,14 +1026,8 @@ int main()
 								sin>>stmp1>>ID>>stmp1;
 								if((stmp1=="GANG"||stmp1=="BUGANG"))isGANG=1;
 								if(paiqiang==0)isLAST=true;
-								MahjongInit();
 								try{
-								    auto re = MahjongFanCalculator(pack, myhand, Card, 0, isZIMO, isJUEZHANG, isGANG, isLAST, myPlayerID, quan);
-								    int ans=0;
-									for(auto i : re){
-								        ans+=i.first;
-								    }
-								    if(ans>=8){sout<<"HU";ok=true;}
+								    if(MahjongFanThreshold(pack, myhand, Card, isZIMO, isJUEZHANG, isGANG, isLAST, myPlayerID, quan, 8)){sout<<"HU";ok=true;}
 								}
 								catch(const string &error){
 								    //
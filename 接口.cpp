@@ -3,6 +3,7 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#define MAHJONGGB_UNITY
 #include "MahjongGB/MahjongGB.h"
 #ifdef _BOTZONE_ONLINE
 #include "jsoncpp/json.h"
@@ -17,6 +18,7 @@ using namespace std;
 
 vector<string> request, response;
 vector<string> hand;
+vector<pair<string, pair<string, int> > > pack;//Լĸ¶
 
 vector<pair<int, string> > MahjongFanCalculator(
     vector<pair<string, pair<string, int> > > pack,
@@ -47,57 +49,15 @@ pii f(string stmp)//
 }
 string ff(int x,int y)//ת2
 {
-   string s="";
-   switch(x){
-		case 1:s+='W';break;
-		case 2:s+='B';break;
-		case 3:s+='T';break;
-		case 4:s+='F';break;
-		case 5:s+='J';break;
-	}
-	s+=char('0'+y);
-	return  s;
+	return string{"?WBTFJ"[x],char('0'+y)};
 }
-bool CheckHu(int num[10],int k){
-	for(int i=1;i<=k;i++)if(num[i]<0)return false;
-	if(num[0]==0)return true;
-	if(num[0]==1)return false;
-	if(num[0]==2){
-		for(int i=1;i<=k;i++)if(num[i]==2)return true;
-		return false;
-	}
-	if(k==9){
-		for(int i=1;i<=9;i++){
-			if(num[i]>0){
-				if(i<=7){
-					num[i]--,num[i+1]--,num[i+2]--;
-					num[0]=num[0]-3;
-					if(CheckHu(num,k))return true;
-					num[0]=num[0]+3;
-					num[i]++,num[i+1]++,num[i+2]++;
-				}
-				if(num[i]>=3){
-					num[i]-=3;num[0]-=3;
-					if(CheckHu(num,k))return true;
-					num[i]+=3;num[0]+=3;
-				}
-			}
-		}return false;
-	}
-    else 
-    {
-    	for(int i=1;i<=k;i++){
-    		if(num[i]>0){
-    			if(num[i]>=3){
-					num[i]-=3;num[0]-=3;
-					if(CheckHu(num,k))return true;
-					num[i]+=3;num[0]+=3;
-				}
-			}
-		}return false;
-	}
+int fff(int myID,int playID)//жǼҹ 
+{
+	if((myID-1+4)%4==playID)return 1;//ϼҹ 
+	if((myID+1)%4==playID)return 3;//¼ҹ 
+	return 2;//Լҹ 
 }
-bool Hu()
+bool Hu(const string &winCard,int menFeng,int quanFeng)
 {
 	if(hand.size()<14||hand.size()>18)return false;
 	int CardCount=0,i;
@@ -106,13 +66,13 @@ bool Hu()
 	} 
 	CardCount=i;//ǰɲ
 	if((CardCount-2)%3!=0)return false;
-	int num[6][10]={0};//ǰͳ
-	for(int i=0;i<CardCount;i++){
-		pii a=f(hand[i]);
-		num[a.first][a.second]++;
-		num[a.first][0]++;
-	}
-	return CheckHu(num[1],9)&&CheckHu(num[2],9)&&CheckHu(num[3],9)&&CheckHu(num[4],4)&&CheckHu(num[5],3);
+	//ɲȥΪƣ¶packȡжǷ8
+	vector<string> standing(hand.begin(),hand.begin()+CardCount);
+	vector<string>::iterator it=find(standing.begin(),standing.end(),winCard);
+	if(it==standing.end())return false;
+	standing.erase(it);
+	if((int)standing.size()+3*(int)pack.size()!=13)return false;//¶¼ȫʱ
+	return MahjongFanThreshold(pack,standing,winCard,true,false,false,false,menFeng,quanFeng,8);
 }
 int main()
 {
@@ -165,7 +125,7 @@ int main()
             pii a=f(stmp);
 			num[a.first][0]--;num[a.first][a.second]--;//ƶѼ 
         }
-        string LastCard="",Laststmp=""; 
+        string LastCard="",Laststmp="";int Lastuser=-1; 
         for(int i = 2; i < turnID; i++) {
             sin.clear();
             sin.str(request[i]);
@@ -180,17 +140,22 @@ int main()
                 if(stmp1=="PLAY")hand.erase(find(hand.begin(), hand.end(), stmp2));//ֱӴ 
                 else if(stmp1=="GANG"){
                 	sort(hand.begin(),hand.end());
-                	for(auto i:hand){
+                	pack.push_back({"GANG",{stmp2,0}});// 
+                	for(auto &i:hand){
                 		if(i==stmp2)i[0]-='A'-'a';//ѸȫСд 
 					}
 					sort(hand.begin(),hand.end());
 				}
                 else if(stmp1=="BUGANG"){
-                	for(auto i:hand){
+                	for(auto &p:pack){
+                		if(p.first=="PENG"&&p.second.first==stmp2)p.first="GANG";//֮ǰֱӸĳɸ 
+					}
+                	for(auto &i:hand){
                 		if(i==stmp2)i[0]-='A'-'a';//ѸȫСд 
 					}
 					sort(hand.begin(),hand.end());
 				}
+				Lastuser=myPlayerID;
             }
             else {
             	sin>>itmp;
@@ -210,8 +175,10 @@ int main()
 					pii a=f(LastCard);
 			        num[a.first][0]-=2;num[a.first][a.second]-=2;//ƶѼ
 			        if(myPlayerID==itmp){  //൱Ƴɹ 
-			        	for(auto i:hand){
-                		    if(i==LastCard)i[0]-='A'-'a';//ȫСд 
+			        	pack.push_back({"PENG",{LastCard,fff(myPlayerID,Lastuser)}});
+			        	int cnt=0;
+			        	for(auto &i:hand){
+                		    if(i==LastCard&&cnt<2)i[0]-='A'-'a',cnt++;//űСд 
 					    }LastCard[0]-='A'-'a';
 					    hand.push_back(LastCard); 
 					    sort(hand.begin(),hand.end());
@@ -238,9 +205,12 @@ int main()
 			        if(myPlayerID==itmp){
 			        	int dx[]={-1,0,1};
 					    for(int i=0;i<3;i++){
-					    	if(b.second==a.second+dx[i])continue;//֮ǰй 
+					    	if(b.second==a.second+dx[i]){//֮ǰйˣϼҹĵi+1 
+					    		pack.push_back({"CHI",{zhongCard,i+1}});
+					    		continue;
+							}
 					    	string s=ff(a.first,a.second+dx[i]);
-						    for(auto i:hand){//ԵתΪ 
+						    for(auto &i:hand){//ԵתΪ 
 			            		if(i==s){
 								    i[0]-='A'-'a';break;//һͺ 
 								}
@@ -263,6 +233,13 @@ int main()
 						// 
 						pii a=f(LastCard);
 			            num[a.first][0]-=3;num[a.first][a.second]-=3;
+			            if(myPlayerID==itmp&&Lastuser!=myPlayerID){//ܱ˴ƣԼƺİѾǹ 
+			            	pack.push_back({"GANG",{LastCard,fff(myPlayerID,Lastuser)}});
+			            	for(auto &i:hand){
+			            		if(i==LastCard)i[0]-='A'-'a';
+							}
+							sort(hand.begin(),hand.end());
+						}
 					} 
 				}
 				else if(stmp=="BUGANG"){
@@ -271,7 +248,7 @@ int main()
 					pii a=f(Card);
 					num[a.first][0]--;num[a.first][a.second]--;
 				}
-				
+				Lastuser=itmp;
 			}
 			Laststmp=stmp;//¼һβ 
         }
@@ -286,7 +263,7 @@ int main()
 			hand.push_back(stmp); 
 			sort(hand.begin(),hand.end());
 			bool ok=false;//ʾǷѾӦ 
-			if(Hu()){
+			if(Hu(stmp,myPlayerID,quan)){
 			    	//㷬
 					void MahjongInit();
 					 